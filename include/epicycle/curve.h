@@ -0,0 +1,127 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <fft/fft.h>
+#include <epicycle/phase_engine.h>
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+
+// The whole path the chain's tip traces, in one inverse FFT. The tip at time
+// t is sum_f c_f exp(i f t) with c_f = radius * exp(i starting_angle), so
+// over one turn of the fundamental, sampled at t = 2 pi m / M, it is exactly
+// the unnormalized backward DFT of the coefficients placed at bin f mod M.
+// Zero padding to M > 2 max|f| gives M points in O(M log M) instead of
+// M * N for running the chain per sample, and since the path is band
+// limited, interpolating between them is smooth.
+//
+// Rebuild only when the coefficients change; sampling is a lookup.
+template <typename T>
+class CurveReconstruction
+{
+public:
+    typedef typename FFTW<T>::complex complex_t;
+
+    CurveReconstruction() = default;
+
+    ~CurveReconstruction()
+    {
+        FFTW<T>::free(spectrum);
+        FFTW<T>::free(curve);
+    }
+
+    // C is anything with starting_angle, frequency and radius (Circle).
+    // Circles above maxFrequency are dropped (0 keeps all). M is raised to
+    // the next power of two that holds every kept frequency.
+    template <typename C>
+    void build(const std::vector<C>& circles, int M, int maxFrequency = 0)
+    {
+        int highest = 0;
+        for (const C& c : circles)
+        {
+            int f = std::abs((int)std::lround(c.frequency));
+            if ((maxFrequency <= 0 || f <= maxFrequency) && f > highest)
+                highest = f;
+        }
+        int size = 1;
+        while (size < M || size <= 2 * highest)
+            size *= 2;
+        resize(size);
+
+        for (int k = 0; k < length; k++)
+            spectrum[k][0] = spectrum[k][1] = T(0);
+
+        for (const C& c : circles)
+        {
+            int f = (int)std::lround(c.frequency);
+            if (maxFrequency > 0 && std::abs(f) > maxFrequency)
+                continue;
+            int k = ((f % length) + length) % length;
+            spectrum[k][0] += T(c.radius * std::cos(c.starting_angle));
+            spectrum[k][1] += T(c.radius * std::sin(c.starting_angle));
+        }
+
+        fft_execute(length, FFTW_BACKWARD, spectrum, curve);
+    }
+
+    int size() const
+    {
+        return length;
+    }
+
+    // point m is the tip at t = 2 pi m / M
+    const complex_t *points() const
+    {
+        return curve;
+    }
+
+    // Tip position at a tick (see phase_ticks), linear between the two
+    // nearest points. The fundamental's fixed-point phase maps straight onto
+    // the curve index, so this agrees with the chain at any uptime.
+    void sample(uint64_t tick, T& x, T& y) const
+    {
+        uint32_t base = (uint32_t)(tick * PHASE_BASE_STEP);
+        uint64_t pos = (uint64_t)base * (uint64_t)length;       // index in the top 32 bits
+        int i = (int)(pos >> 32);
+        int j = (i + 1 == length) ? 0 : i + 1;
+        T frac = T(uint32_t(pos)) * T(1.0 / 4294967296.0);
+        x = curve[i][0] + (curve[j][0] - curve[i][0]) * frac;
+        y = curve[i][1] + (curve[j][1] - curve[i][1]) * frac;
+    }
+
+    // Interleaved x, y, z = 0 per point, ready for a GL_ARRAY_BUFFER
+    void vertices(std::vector<float>& out) const
+    {
+        out.resize(3 * (size_t)length);
+        for (int m = 0; m < length; m++)
+        {
+            out[3 * m] = float(curve[m][0]);
+            out[3 * m + 1] = float(curve[m][1]);
+            out[3 * m + 2] = 0.0f;
+        }
+    }
+
+private:
+    CurveReconstruction(const CurveReconstruction&) = delete;
+    CurveReconstruction& operator=(const CurveReconstruction&) = delete;
+
+    void resize(int size)
+    {
+        if (size == length)
+            return;
+        FFTW<T>::free(spectrum);
+        FFTW<T>::free(curve);
+        length = size;
+        spectrum = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * length);
+        curve = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * length);
+    }
+
+    int length = 0;
+    complex_t *spectrum = NULL;
+    complex_t *curve = NULL;
+};
+
+
+#endif
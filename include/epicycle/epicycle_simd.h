@@ -0,0 +1,489 @@
+#ifndef EPICYCLE_SIMD_H
+#define EPICYCLE_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EPICYCLE_X86 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define EPICYCLE_NEON 1
+#endif
+
+
+// Per-frame kernels for the epicycle chain, over struct-of-arrays circles in
+// 32-bit fixed-point phase (2^32 = one turn, see phase_engine.h). For every
+// circle they compute the current phase, its angle, cos and sin, the rotated
+// radius vector, and the running sum of those vectors, which is where the
+// circle is drawn. The epicycle_sum_* variants only return the total (the tip)
+// and read nothing but the coefficients, for evaluating many times at once;
+// epicycle_rotate_* sum a set of phasors and advance each by its own step.
+//
+// The SIMD kernels evaluate sin/cos with polynomials instead of the sine
+// table (a table gather costs more than the polynomial). Range reduction is
+// done on the integer phase: the top two bits (rounded) pick the quadrant and
+// the rest is an exact remainder in [-pi/4, pi/4], where the minimax
+// polynomials are accurate to about 1 ulp.
+//
+// Which kernel runs is decided at runtime from the CPU, like fft_backend() it
+// can be overridden.
+
+enum EpicycleKernel
+{
+    EPICYCLE_SCALAR,
+    EPICYCLE_SSE2,
+    EPICYCLE_AVX2,
+    EPICYCLE_NEON
+};
+
+// The kernels process this many circles per step, arrays are padded to it
+const int EPICYCLE_BLOCK = 16;
+
+struct EpicycleArrays
+{
+    const uint32_t *startPhase;
+    const int32_t *frequency;
+    const float *radius;
+    float *angle;
+    float *cosine;
+    float *sine;
+    float *x;           // centre of circle i, the sum of the vectors before it
+    float *y;
+    size_t count;       // multiple of EPICYCLE_BLOCK, padding has radius 0
+};
+
+inline const char *epicycle_kernel_name(EpicycleKernel kernel)
+{
+    switch (kernel)
+    {
+    case EPICYCLE_SSE2: return "sse2";
+    case EPICYCLE_AVX2: return "avx2";
+    case EPICYCLE_NEON: return "neon";
+    default:            return "scalar";
+    }
+}
+
+inline bool epicycle_kernel_supported(EpicycleKernel kernel)
+{
+    switch (kernel)
+    {
+    case EPICYCLE_SCALAR:
+        return true;
+#if defined(EPICYCLE_X86) && defined(__SSE2__)
+    case EPICYCLE_SSE2:
+        return true;
+#endif
+#if defined(EPICYCLE_X86) && defined(__GNUC__)
+    case EPICYCLE_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#if defined(EPICYCLE_NEON)
+    case EPICYCLE_NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+inline EpicycleKernel& epicycle_kernel()
+{
+    static EpicycleKernel kernel = []() {
+        const EpicycleKernel preferred[] = {EPICYCLE_AVX2, EPICYCLE_NEON, EPICYCLE_SSE2};
+        for (EpicycleKernel k : preferred)
+        {
+            if (epicycle_kernel_supported(k))
+                return k;
+        }
+        return EPICYCLE_SCALAR;
+    }();
+    return kernel;
+}
+
+// cephes sinf/cosf coefficients for |x| <= pi/4
+const float EPICYCLE_SIN1 = -1.6666654611e-1f;
+const float EPICYCLE_SIN2 = 8.3321608736e-3f;
+const float EPICYCLE_SIN3 = -1.9515295891e-4f;
+const float EPICYCLE_COS1 = 4.166664568298827e-2f;
+const float EPICYCLE_COS2 = -1.388731625493765e-3f;
+const float EPICYCLE_COS3 = 2.443315711809948e-5f;
+
+// radians per phase unit
+const float EPICYCLE_PHASE_TO_ANGLE = float(2.0 * M_PI / 4294967296.0);
+
+// -------------------- x86 --------------------
+#if defined(EPICYCLE_X86) && defined(__SSE2__)
+// SSE2 has no 32-bit mullo, build it from the two 32x32->64 products
+inline __m128i epicycle_mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// sin and cos of four fixed-point phases
+inline void epicycle_sincos_sse2(__m128i p, __m128& sinv, __m128& cosv)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+
+    // quadrant and exact remainder
+    __m128i q = _mm_srli_epi32(_mm_add_epi32(p, _mm_set1_epi32(1 << 29)), 30);
+    __m128i r = _mm_sub_epi32(p, _mm_slli_epi32(q, 30));
+    __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(r), _mm_set1_ps(EPICYCLE_PHASE_TO_ANGLE));
+    __m128 z = _mm_mul_ps(x, x);
+
+    __m128 s = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(EPICYCLE_SIN3)), _mm_set1_ps(EPICYCLE_SIN2));
+    s = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(EPICYCLE_SIN1));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), x), x);
+    __m128 c = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(EPICYCLE_COS3)), _mm_set1_ps(EPICYCLE_COS2));
+    c = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(EPICYCLE_COS1));
+    c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sin and cos, then the signs
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    sinv = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    cosv = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+    sinv = _mm_xor_ps(sinv, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30)));
+    cosv = _mm_xor_ps(cosv, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30)));
+}
+
+inline void epicycle_eval_sse2(const EpicycleArrays& a, uint32_t base, float& tipX, float& tipY)
+{
+    const __m128i vbase = _mm_set1_epi32((int)base);
+    const __m128 toAngle = _mm_set1_ps(EPICYCLE_PHASE_TO_ANGLE);
+
+    __m128 carryX = _mm_setzero_ps();
+    __m128 carryY = _mm_setzero_ps();
+
+    for (size_t i = 0; i < a.count; i += 4)
+    {
+        __m128i p = _mm_add_epi32(_mm_load_si128((const __m128i*)(a.startPhase + i)),
+                                  epicycle_mullo_sse2(_mm_load_si128((const __m128i*)(a.frequency + i)), vbase));
+        __m128 sinv, cosv;
+        epicycle_sincos_sse2(p, sinv, cosv);
+
+        __m128 radius = _mm_load_ps(a.radius + i);
+        __m128 vx = _mm_mul_ps(radius, cosv);
+        __m128 vy = _mm_mul_ps(radius, sinv);
+
+        _mm_store_ps(a.angle + i, _mm_mul_ps(_mm_cvtepi32_ps(p), toAngle));
+        _mm_store_ps(a.cosine + i, cosv);
+        _mm_store_ps(a.sine + i, sinv);
+
+        // inclusive scan in register, the centre is that minus the circle's own vector
+        __m128 sx = _mm_add_ps(vx, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(vx), 4)));
+        __m128 sy = _mm_add_ps(vy, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(vy), 4)));
+        sx = _mm_add_ps(sx, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sx), 8)));
+        sy = _mm_add_ps(sy, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(sy), 8)));
+        sx = _mm_add_ps(sx, carryX);
+        sy = _mm_add_ps(sy, carryY);
+
+        _mm_store_ps(a.x + i, _mm_sub_ps(sx, vx));
+        _mm_store_ps(a.y + i, _mm_sub_ps(sy, vy));
+
+        carryX = _mm_shuffle_ps(sx, sx, _MM_SHUFFLE(3, 3, 3, 3));
+        carryY = _mm_shuffle_ps(sy, sy, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    tipX = _mm_cvtss_f32(carryX);
+    tipY = _mm_cvtss_f32(carryY);
+}
+
+inline void epicycle_sum_sse2(const EpicycleArrays& a, uint32_t base, float& sumX, float& sumY)
+{
+    const __m128i vbase = _mm_set1_epi32((int)base);
+
+    __m128 accX = _mm_setzero_ps();
+    __m128 accY = _mm_setzero_ps();
+
+    for (size_t i = 0; i < a.count; i += 4)
+    {
+        __m128i p = _mm_add_epi32(_mm_load_si128((const __m128i*)(a.startPhase + i)),
+                                  epicycle_mullo_sse2(_mm_load_si128((const __m128i*)(a.frequency + i)), vbase));
+        __m128 sinv, cosv;
+        epicycle_sincos_sse2(p, sinv, cosv);
+
+        __m128 radius = _mm_load_ps(a.radius + i);
+        accX = _mm_add_ps(accX, _mm_mul_ps(radius, cosv));
+        accY = _mm_add_ps(accY, _mm_mul_ps(radius, sinv));
+    }
+
+    float lx[4], ly[4];
+    _mm_storeu_ps(lx, accX);
+    _mm_storeu_ps(ly, accY);
+    sumX = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    sumY = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+}
+
+inline void epicycle_rotate_sse2(float *re, float *im, const float *wRe, const float *wIm, size_t count,
+                                 float& sumX, float& sumY)
+{
+    __m128 accX = _mm_setzero_ps();
+    __m128 accY = _mm_setzero_ps();
+
+    for (size_t i = 0; i < count; i += 4)
+    {
+        __m128 zr = _mm_load_ps(re + i), zi = _mm_load_ps(im + i);
+        __m128 wr = _mm_load_ps(wRe + i), wi = _mm_load_ps(wIm + i);
+        accX = _mm_add_ps(accX, zr);
+        accY = _mm_add_ps(accY, zi);
+        _mm_store_ps(re + i, _mm_sub_ps(_mm_mul_ps(zr, wr), _mm_mul_ps(zi, wi)));
+        _mm_store_ps(im + i, _mm_add_ps(_mm_mul_ps(zr, wi), _mm_mul_ps(zi, wr)));
+    }
+
+    float lx[4], ly[4];
+    _mm_storeu_ps(lx, accX);
+    _mm_storeu_ps(ly, accY);
+    sumX = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    sumY = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+}
+#endif
+
+#if defined(EPICYCLE_X86) && defined(__GNUC__)
+// Compiled for AVX2 whatever the build flags, only called when the CPU has it
+#define EPICYCLE_AVX2_TARGET __attribute__((target("avx2")))
+
+EPICYCLE_AVX2_TARGET inline void epicycle_sincos_avx2(__m256i p, __m256& sinv, __m256& cosv)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+
+    __m256i q = _mm256_srli_epi32(_mm256_add_epi32(p, _mm256_set1_epi32(1 << 29)), 30);
+    __m256i r = _mm256_sub_epi32(p, _mm256_slli_epi32(q, 30));
+    __m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(r), _mm256_set1_ps(EPICYCLE_PHASE_TO_ANGLE));
+    __m256 z = _mm256_mul_ps(x, x);
+
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(EPICYCLE_SIN3)), _mm256_set1_ps(EPICYCLE_SIN2));
+    s = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(EPICYCLE_SIN1));
+    s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), x), x);
+    __m256 c = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(EPICYCLE_COS3)), _mm256_set1_ps(EPICYCLE_COS2));
+    c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(EPICYCLE_COS1));
+    c = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    sinv = _mm256_blendv_ps(s, c, swap);
+    cosv = _mm256_blendv_ps(c, s, swap);
+    sinv = _mm256_xor_ps(sinv, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30)));
+    cosv = _mm256_xor_ps(cosv, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30)));
+}
+
+EPICYCLE_AVX2_TARGET inline void epicycle_eval_avx2(const EpicycleArrays& a, uint32_t base, float& tipX, float& tipY)
+{
+    const __m256i vbase = _mm256_set1_epi32((int)base);
+    const __m256i last = _mm256_set1_epi32(7);
+    const __m256 toAngle = _mm256_set1_ps(EPICYCLE_PHASE_TO_ANGLE);
+
+    __m256 carryX = _mm256_setzero_ps();
+    __m256 carryY = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < a.count; i += 8)
+    {
+        __m256i p = _mm256_add_epi32(_mm256_load_si256((const __m256i*)(a.startPhase + i)),
+                                     _mm256_mullo_epi32(_mm256_load_si256((const __m256i*)(a.frequency + i)), vbase));
+        __m256 sinv, cosv;
+        epicycle_sincos_avx2(p, sinv, cosv);
+
+        __m256 radius = _mm256_load_ps(a.radius + i);
+        __m256 vx = _mm256_mul_ps(radius, cosv);
+        __m256 vy = _mm256_mul_ps(radius, sinv);
+
+        _mm256_store_ps(a.angle + i, _mm256_mul_ps(_mm256_cvtepi32_ps(p), toAngle));
+        _mm256_store_ps(a.cosine + i, cosv);
+        _mm256_store_ps(a.sine + i, sinv);
+
+        // scan each 128-bit half, then carry the low half's total into the high half
+        __m256 sx = _mm256_add_ps(vx, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(vx), 4)));
+        __m256 sy = _mm256_add_ps(vy, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(vy), 4)));
+        sx = _mm256_add_ps(sx, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sx), 8)));
+        sy = _mm256_add_ps(sy, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(sy), 8)));
+        __m256 lowX = _mm256_permute_ps(sx, _MM_SHUFFLE(3, 3, 3, 3));
+        __m256 lowY = _mm256_permute_ps(sy, _MM_SHUFFLE(3, 3, 3, 3));
+        sx = _mm256_add_ps(sx, _mm256_permute2f128_ps(lowX, lowX, 0x08));
+        sy = _mm256_add_ps(sy, _mm256_permute2f128_ps(lowY, lowY, 0x08));
+        sx = _mm256_add_ps(sx, carryX);
+        sy = _mm256_add_ps(sy, carryY);
+
+        _mm256_store_ps(a.x + i, _mm256_sub_ps(sx, vx));
+        _mm256_store_ps(a.y + i, _mm256_sub_ps(sy, vy));
+
+        carryX = _mm256_permutevar8x32_ps(sx, last);
+        carryY = _mm256_permutevar8x32_ps(sy, last);
+    }
+
+    tipX = _mm256_cvtss_f32(carryX);
+    tipY = _mm256_cvtss_f32(carryY);
+}
+
+EPICYCLE_AVX2_TARGET inline void epicycle_sum_avx2(const EpicycleArrays& a, uint32_t base, float& sumX, float& sumY)
+{
+    const __m256i vbase = _mm256_set1_epi32((int)base);
+
+    __m256 accX = _mm256_setzero_ps();
+    __m256 accY = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < a.count; i += 8)
+    {
+        __m256i p = _mm256_add_epi32(_mm256_load_si256((const __m256i*)(a.startPhase + i)),
+                                     _mm256_mullo_epi32(_mm256_load_si256((const __m256i*)(a.frequency + i)), vbase));
+        __m256 sinv, cosv;
+        epicycle_sincos_avx2(p, sinv, cosv);
+
+        __m256 radius = _mm256_load_ps(a.radius + i);
+        accX = _mm256_add_ps(accX, _mm256_mul_ps(radius, cosv));
+        accY = _mm256_add_ps(accY, _mm256_mul_ps(radius, sinv));
+    }
+
+    __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(accX), _mm256_extractf128_ps(accX, 1));
+    __m128 y4 = _mm_add_ps(_mm256_castps256_ps128(accY), _mm256_extractf128_ps(accY, 1));
+    float lx[4], ly[4];
+    _mm_storeu_ps(lx, x4);
+    _mm_storeu_ps(ly, y4);
+    sumX = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    sumY = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+}
+
+EPICYCLE_AVX2_TARGET inline void epicycle_rotate_avx2(float *re, float *im, const float *wRe, const float *wIm,
+                                                      size_t count, float& sumX, float& sumY)
+{
+    __m256 accX = _mm256_setzero_ps();
+    __m256 accY = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < count; i += 8)
+    {
+        __m256 zr = _mm256_load_ps(re + i), zi = _mm256_load_ps(im + i);
+        __m256 wr = _mm256_load_ps(wRe + i), wi = _mm256_load_ps(wIm + i);
+        accX = _mm256_add_ps(accX, zr);
+        accY = _mm256_add_ps(accY, zi);
+        _mm256_store_ps(re + i, _mm256_sub_ps(_mm256_mul_ps(zr, wr), _mm256_mul_ps(zi, wi)));
+        _mm256_store_ps(im + i, _mm256_add_ps(_mm256_mul_ps(zr, wi), _mm256_mul_ps(zi, wr)));
+    }
+
+    __m128 x4 = _mm_add_ps(_mm256_castps256_ps128(accX), _mm256_extractf128_ps(accX, 1));
+    __m128 y4 = _mm_add_ps(_mm256_castps256_ps128(accY), _mm256_extractf128_ps(accY, 1));
+    float lx[4], ly[4];
+    _mm_storeu_ps(lx, x4);
+    _mm_storeu_ps(ly, y4);
+    sumX = (lx[0] + lx[1]) + (lx[2] + lx[3]);
+    sumY = (ly[0] + ly[1]) + (ly[2] + ly[3]);
+}
+#endif
+
+// -------------------- arm --------------------
+#if defined(EPICYCLE_NEON)
+inline void epicycle_sincos_neon(uint32x4_t p, float32x4_t& sinv, float32x4_t& cosv)
+{
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t two = vdupq_n_u32(2);
+
+    uint32x4_t q = vshrq_n_u32(vaddq_u32(p, vdupq_n_u32(1u << 29)), 30);
+    int32x4_t r = vreinterpretq_s32_u32(vsubq_u32(p, vshlq_n_u32(q, 30)));
+    float32x4_t x = vmulq_f32(vcvtq_f32_s32(r), vdupq_n_f32(EPICYCLE_PHASE_TO_ANGLE));
+    float32x4_t z = vmulq_f32(x, x);
+
+    float32x4_t s = vmlaq_f32(vdupq_n_f32(EPICYCLE_SIN2), z, vdupq_n_f32(EPICYCLE_SIN3));
+    s = vmlaq_f32(vdupq_n_f32(EPICYCLE_SIN1), s, z);
+    s = vmlaq_f32(x, vmulq_f32(s, z), x);
+    float32x4_t c = vmlaq_f32(vdupq_n_f32(EPICYCLE_COS2), z, vdupq_n_f32(EPICYCLE_COS3));
+    c = vmlaq_f32(vdupq_n_f32(EPICYCLE_COS1), c, z);
+    c = vmlaq_f32(vmlsq_f32(vdupq_n_f32(1.0f), z, vdupq_n_f32(0.5f)), vmulq_f32(c, z), z);
+
+    uint32x4_t swap = vceqq_u32(vandq_u32(q, one), one);
+    sinv = vbslq_f32(swap, c, s);
+    cosv = vbslq_f32(swap, s, c);
+    sinv = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sinv), vshlq_n_u32(vandq_u32(q, two), 30)));
+    cosv = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cosv), vshlq_n_u32(vandq_u32(vaddq_u32(q, one), two), 30)));
+}
+
+inline void epicycle_eval_neon(const EpicycleArrays& a, uint32_t base, float& tipX, float& tipY)
+{
+    const uint32x4_t vbase = vdupq_n_u32(base);
+    const float32x4_t toAngle = vdupq_n_f32(EPICYCLE_PHASE_TO_ANGLE);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+
+    float32x4_t carryX = zero;
+    float32x4_t carryY = zero;
+
+    for (size_t i = 0; i < a.count; i += 4)
+    {
+        uint32x4_t freq = vreinterpretq_u32_s32(vld1q_s32(a.frequency + i));
+        uint32x4_t p = vmlaq_u32(vld1q_u32(a.startPhase + i), freq, vbase);
+        float32x4_t sinv, cosv;
+        epicycle_sincos_neon(p, sinv, cosv);
+
+        float32x4_t radius = vld1q_f32(a.radius + i);
+        float32x4_t vx = vmulq_f32(radius, cosv);
+        float32x4_t vy = vmulq_f32(radius, sinv);
+
+        vst1q_f32(a.angle + i, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(p)), toAngle));
+        vst1q_f32(a.cosine + i, cosv);
+        vst1q_f32(a.sine + i, sinv);
+
+        float32x4_t sx = vaddq_f32(vx, vextq_f32(zero, vx, 3));
+        float32x4_t sy = vaddq_f32(vy, vextq_f32(zero, vy, 3));
+        sx = vaddq_f32(sx, vextq_f32(zero, sx, 2));
+        sy = vaddq_f32(sy, vextq_f32(zero, sy, 2));
+        sx = vaddq_f32(sx, carryX);
+        sy = vaddq_f32(sy, carryY);
+
+        vst1q_f32(a.x + i, vsubq_f32(sx, vx));
+        vst1q_f32(a.y + i, vsubq_f32(sy, vy));
+
+        carryX = vdupq_laneq_f32(sx, 3);
+        carryY = vdupq_laneq_f32(sy, 3);
+    }
+
+    tipX = vgetq_lane_f32(carryX, 0);
+    tipY = vgetq_lane_f32(carryY, 0);
+}
+
+inline void epicycle_sum_neon(const EpicycleArrays& a, uint32_t base, float& sumX, float& sumY)
+{
+    const uint32x4_t vbase = vdupq_n_u32(base);
+
+    float32x4_t accX = vdupq_n_f32(0.0f);
+    float32x4_t accY = vdupq_n_f32(0.0f);
+
+    for (size_t i = 0; i < a.count; i += 4)
+    {
+        uint32x4_t freq = vreinterpretq_u32_s32(vld1q_s32(a.frequency + i));
+        uint32x4_t p = vmlaq_u32(vld1q_u32(a.startPhase + i), freq, vbase);
+        float32x4_t sinv, cosv;
+        epicycle_sincos_neon(p, sinv, cosv);
+
+        float32x4_t radius = vld1q_f32(a.radius + i);
+        accX = vmlaq_f32(accX, radius, cosv);
+        accY = vmlaq_f32(accY, radius, sinv);
+    }
+
+    sumX = vaddvq_f32(accX);
+    sumY = vaddvq_f32(accY);
+}
+
+inline void epicycle_rotate_neon(float *re, float *im, const float *wRe, const float *wIm, size_t count,
+                                 float& sumX, float& sumY)
+{
+    float32x4_t accX = vdupq_n_f32(0.0f);
+    float32x4_t accY = vdupq_n_f32(0.0f);
+
+    for (size_t i = 0; i < count; i += 4)
+    {
+        float32x4_t zr = vld1q_f32(re + i), zi = vld1q_f32(im + i);
+        float32x4_t wr = vld1q_f32(wRe + i), wi = vld1q_f32(wIm + i);
+        accX = vaddq_f32(accX, zr);
+        accY = vaddq_f32(accY, zi);
+        vst1q_f32(re + i, vmlsq_f32(vmulq_f32(zr, wr), zi, wi));
+        vst1q_f32(im + i, vmlaq_f32(vmulq_f32(zr, wi), zi, wr));
+    }
+
+    sumX = vaddvq_f32(accX);
+    sumY = vaddvq_f32(accY);
+}
+#endif
+
+
+#endif
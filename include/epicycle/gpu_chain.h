@@ -0,0 +1,142 @@
+#ifndef GPU_CHAIN_H
+#define GPU_CHAIN_H
+
+#include <glad/glad.h>
+#include <gl_ext/gl_ext.h>
+#include <shader/shader.h>
+#include <epicycle/phase_engine.h>
+
+#include <stdint.h>
+#include <vector>
+
+
+// The epicycle chain evaluated by shaders/epicycle.comp. Coefficients live in
+// a storage buffer and are only uploaded by load(); a frame is one uniform
+// (the fixed-point base phase) and three dispatches, after which the instance
+// buffer holds every circle's centre and radius vector for the vertex shader
+// to read (shaders/shader_gpu.vert). Needs GL 4.3, check gl_ext_load() first.
+class GpuChain
+{
+public:
+    static const int GROUP = 256;               // must match epicycle.comp
+    static const int BLOCK = 2 * GROUP;
+
+    GpuChain() = default;
+
+    ~GpuChain()
+    {
+        if (buffers[0])  glDeleteBuffers(3, buffers);
+        if (program.ID)  glDeleteProgram(program.ID);
+    }
+
+    void init(const char *computeFile)
+    {
+        program.initCompute(computeFile);
+        glGenBuffers(3, buffers);
+
+        baseLoc = glGetUniformLocation(program.ID, "basePhase");
+        countLoc = glGetUniformLocation(program.ID, "count");
+        blocksLoc = glGetUniformLocation(program.ID, "blocks");
+        stageLoc = glGetUniformLocation(program.ID, "stage");
+    }
+
+    // C is anything with starting_angle, frequency and radius (Circle)
+    template <typename C>
+    void load(const std::vector<C>& circles)
+    {
+        count = (unsigned)circles.size();
+        blocks = (count + BLOCK - 1) / BLOCK;
+
+        std::vector<Coefficient> coeffs(count);
+        for (unsigned i = 0; i < count; i++)
+        {
+            coeffs[i].startPhase = phase_from_angle(circles[i].starting_angle);
+            coeffs[i].frequency = (int32_t)std::lround(circles[i].frequency);
+            coeffs[i].radius = circles[i].radius;
+            coeffs[i].pad = 0;
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COEFFICIENTS]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Coefficient) * (count ? count : 1), coeffs.data(), GL_STATIC_DRAW);
+
+        // the shader writes both of these, sized only when the count changes
+        if (count != allocated)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[INSTANCES]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * 4 * (count ? count : 1), NULL, GL_DYNAMIC_COPY);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BLOCK_SUMS]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * 2 * (blocks ? blocks : 1), NULL, GL_DYNAMIC_COPY);
+            allocated = count;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Evaluates the chain for this tick (see phase_ticks), the only per-frame
+    // CPU work is the base phase uniform
+    void dispatch(uint64_t tick)
+    {
+        if (!count)
+            return;
+
+        program.use();
+        glUniform1ui(baseLoc, (uint32_t)(tick * PHASE_BASE_STEP));
+        glUniform1ui(countLoc, count);
+        glUniform1ui(blocksLoc, blocks);
+        bind();
+
+        glUniform1i(stageLoc, 0);
+        glDispatchCompute(blocks, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUniform1i(stageLoc, 1);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUniform1i(stageLoc, 2);
+        glDispatchCompute((count + GROUP - 1) / GROUP, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // x, y = centre, z, w = radius * (cos, sin) per circle, bound at binding 1
+    GLuint instanceBuffer() const
+    {
+        return buffers[INSTANCES];
+    }
+
+    unsigned size() const
+    {
+        return count;
+    }
+
+private:
+    GpuChain(const GpuChain&) = delete;
+    GpuChain& operator=(const GpuChain&) = delete;
+
+    // std430 layout of Coefficient in epicycle.comp
+    struct Coefficient
+    {
+        uint32_t startPhase;
+        int32_t frequency;
+        float radius;
+        float pad;
+    };
+
+    enum { COEFFICIENTS, INSTANCES, BLOCK_SUMS };
+
+    void bind()
+    {
+        for (GLuint b = 0; b < 3; b++)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, b, buffers[b]);
+    }
+
+    Shader program;
+    GLuint buffers[3] = {0, 0, 0};
+    GLint baseLoc = -1, countLoc = -1, blocksLoc = -1, stageLoc = -1;
+
+    unsigned count = 0;
+    unsigned blocks = 0;
+    unsigned allocated = ~0u;
+};
+
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <epicycle/epicycle_simd.h>
+
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// Level of detail for the tail of the chain. Circle i's vector can move the
+// tip by at most its radius, so the suffix sum bound[i] = sum_{j >= i} r_j
+// (over the circles that turn) bounds how far the whole tail from i on can
+// ever pull the tip away from the end of circle i - 1. Once that is below a
+// pixel the tail is invisible and need not be evaluated or drawn at all.
+//
+// Frequency 0 circles never turn, their part of the tail is a constant
+// offset, kept exactly instead of counted in the bound. Between "invisible"
+// and "every circle visible" the tail is shown as one envelope disc of radius
+// bound[cut] around the truncated tip: the real tip is somewhere inside it.
+//
+// Cuts are rounded up to EPICYCLE_BLOCK so the kernels still see whole
+// blocks, which only makes the result slightly more exact.
+class ChainLod
+{
+public:
+    struct Cut
+    {
+        size_t count;           // circles to evaluate and draw
+        float offsetX;          // constant part of the dropped tail
+        float offsetY;
+        float envelope;         // bound on the rest, 0 when nothing is dropped
+    };
+
+    // C is anything with starting_angle, frequency and radius (Circle)
+    template <typename C>
+    void build(const std::vector<C>& circles)
+    {
+        size_t n = circles.size();
+        bound.assign(n + 1, 0.0f);
+        offsetX.assign(n + 1, 0.0f);
+        offsetY.assign(n + 1, 0.0f);
+
+        // summed from the small end in double, the bounds must not round low
+        double b = 0, ox = 0, oy = 0;
+        for (size_t i = n; i-- > 0;)
+        {
+            const C& c = circles[i];
+            if (std::lround(c.frequency) == 0)
+            {
+                ox += c.radius * std::cos(c.starting_angle);
+                oy += c.radius * std::sin(c.starting_angle);
+            }
+            else
+                b += std::fabs(c.radius);
+            bound[i] = float(b);
+            offsetX[i] = float(ox);
+            offsetY[i] = float(oy);
+        }
+    }
+
+    size_t size() const
+    {
+        return bound.empty() ? 0 : bound.size() - 1;
+    }
+
+    // The shortest prefix whose dropped tail moves the tip by at most
+    // tolerance (world units); bound is non-increasing so a binary search
+    Cut cut(float tolerance) const
+    {
+        size_t n = size();
+        size_t lo = 0, hi = n;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (bound[mid] <= tolerance)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        size_t count = std::min(n, (lo + EPICYCLE_BLOCK - 1) / EPICYCLE_BLOCK * EPICYCLE_BLOCK);
+        Cut c;
+        c.count = count;
+        c.offsetX = n ? offsetX[count] : 0.0f;
+        c.offsetY = n ? offsetY[count] : 0.0f;
+        c.envelope = n ? bound[count] : 0.0f;
+        return c;
+    }
+
+    float tailBound(size_t i) const
+    {
+        return i < bound.size() ? bound[i] : 0.0f;
+    }
+
+private:
+    std::vector<float> bound;
+    std::vector<float> offsetX;
+    std::vector<float> offsetY;
+};
+
+// World units per framebuffer pixel for the renderer's projection, which
+// maps [-1, 1] across the width; zoom > 1 magnifies
+inline float lod_world_per_pixel(int framebufferWidth, float zoom = 1.0f)
+{
+    return 2.0f / (float(framebufferWidth > 0 ? framebufferWidth : 1) * zoom);
+}
+
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef PHASE_ENGINE_H
+#define PHASE_ENGINE_H
+
+#include <epicycle/epicycle_simd.h>
+#include <thread_pool/thread_pool.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// Fixed-point phase: one full turn is 2^32, so uint32_t arithmetic wraps
+// exactly at 2 pi and a phase never loses precision however long it runs.
+// Time is counted in integer ticks; the fundamental (frequency 1) advances
+// PHASE_BASE_STEP per tick and frequency f advances f times that. Every phase
+// is an exact function of the tick count, so after days of uptime the chain
+// traces the same path it did in the first second.
+//
+// The step is a round integer and the tick rate follows from it: at
+// 2^32 / (2 pi * 10430), about 65538.38 ticks per second, frequency 1 turns
+// at exactly 1 rad/s. (With 65536 ticks per second the step would be
+// 10430.378, and truncating it made the chain run 3.6e-5 slow.) A turn is
+// not a whole number of ticks, 2 pi s can't be, but every tick's phase is
+// still exact.
+const uint32_t PHASE_BASE_STEP = 10430;
+const double PHASE_TICK_RATE = 4294967296.0 / (2.0 * M_PI * PHASE_BASE_STEP);     // ticks per second
+
+inline uint64_t phase_ticks(double seconds)
+{
+    return (uint64_t)(seconds * PHASE_TICK_RATE);
+}
+
+inline uint32_t phase_from_angle(double radians)
+{
+    double turns = radians / (2.0 * M_PI);
+    turns -= std::floor(turns);
+    return (uint32_t)(uint64_t)std::llround(turns * 4294967296.0);
+}
+
+inline float phase_to_angle(uint32_t phase)
+{
+    return float(phase * (2.0 * M_PI / 4294967296.0));
+}
+
+// sin over one turn in 2^SINE_TABLE_BITS steps, linearly interpolated.
+// 4096 entries keep the error around 3e-7, below float resolution for the
+// unit circle, in 16 KB that stays in L1.
+const int SINE_TABLE_BITS = 12;
+const int SINE_TABLE_SIZE = 1 << SINE_TABLE_BITS;
+
+inline const float *sine_table()
+{
+    static std::vector<float> table = []() {
+        std::vector<float> t(SINE_TABLE_SIZE + 1);
+        for (int i = 0; i <= SINE_TABLE_SIZE; i++)
+            t[i] = float(std::sin(2.0 * M_PI * i / SINE_TABLE_SIZE));
+        return t;
+    }();
+    return table.data();
+}
+
+inline float lut_sin(const float *table, uint32_t phase)
+{
+    uint32_t i = phase >> (32 - SINE_TABLE_BITS);
+    float frac = float(phase & ((1u << (32 - SINE_TABLE_BITS)) - 1)) * (1.0f / (1u << (32 - SINE_TABLE_BITS)));
+    return table[i] + (table[i + 1] - table[i]) * frac;
+}
+
+inline float lut_cos(const float *table, uint32_t phase)
+{
+    return lut_sin(table, phase + 0x40000000u);
+}
+
+// Table driven fallback for CPUs without a SIMD kernel
+inline void epicycle_eval_scalar(const EpicycleArrays& a, uint32_t base, float& tipX, float& tipY)
+{
+    const float *table = sine_table();
+
+    float px = 0, py = 0;
+    for (size_t i = 0; i < a.count; i++)
+    {
+        uint32_t p = a.startPhase[i] + (uint32_t)a.frequency[i] * base;
+        float c = lut_cos(table, p);
+        float s = lut_sin(table, p);
+        a.angle[i] = float(int32_t(p)) * EPICYCLE_PHASE_TO_ANGLE;
+        a.cosine[i] = c;
+        a.sine[i] = s;
+        a.x[i] = px;
+        a.y[i] = py;
+        px += a.radius[i] * c;
+        py += a.radius[i] * s;
+    }
+
+    tipX = px;
+    tipY = py;
+}
+
+inline void epicycle_evaluate(EpicycleKernel kernel, const EpicycleArrays& a, uint32_t base, float& tipX, float& tipY)
+{
+    switch (kernel)
+    {
+#if defined(EPICYCLE_X86) && defined(__GNUC__)
+    case EPICYCLE_AVX2:
+        epicycle_eval_avx2(a, base, tipX, tipY);
+        return;
+#endif
+#if defined(EPICYCLE_X86) && defined(__SSE2__)
+    case EPICYCLE_SSE2:
+        epicycle_eval_sse2(a, base, tipX, tipY);
+        return;
+#endif
+#if defined(EPICYCLE_NEON)
+    case EPICYCLE_NEON:
+        epicycle_eval_neon(a, base, tipX, tipY);
+        return;
+#endif
+    default:
+        epicycle_eval_scalar(a, base, tipX, tipY);
+        return;
+    }
+}
+
+inline void epicycle_sum_scalar(const EpicycleArrays& a, uint32_t base, float& sumX, float& sumY)
+{
+    const float *table = sine_table();
+
+    float px = 0, py = 0;
+    for (size_t i = 0; i < a.count; i++)
+    {
+        uint32_t p = a.startPhase[i] + (uint32_t)a.frequency[i] * base;
+        px += a.radius[i] * lut_cos(table, p);
+        py += a.radius[i] * lut_sin(table, p);
+    }
+
+    sumX = px;
+    sumY = py;
+}
+
+// Only the tip, the output arrays of a are not touched
+inline void epicycle_sum(EpicycleKernel kernel, const EpicycleArrays& a, uint32_t base, float& sumX, float& sumY)
+{
+    switch (kernel)
+    {
+#if defined(EPICYCLE_X86) && defined(__GNUC__)
+    case EPICYCLE_AVX2:
+        epicycle_sum_avx2(a, base, sumX, sumY);
+        return;
+#endif
+#if defined(EPICYCLE_X86) && defined(__SSE2__)
+    case EPICYCLE_SSE2:
+        epicycle_sum_sse2(a, base, sumX, sumY);
+        return;
+#endif
+#if defined(EPICYCLE_NEON)
+    case EPICYCLE_NEON:
+        epicycle_sum_neon(a, base, sumX, sumY);
+        return;
+#endif
+    default:
+        epicycle_sum_scalar(a, base, sumX, sumY);
+        return;
+    }
+}
+
+// Sums re + i im, then multiplies every element by w (one recurrence step)
+inline void epicycle_rotate_scalar(float *re, float *im, const float *wRe, const float *wIm, size_t count,
+                                   float& sumX, float& sumY)
+{
+    float px = 0, py = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        float r = re[i], m = im[i];
+        px += r;
+        py += m;
+        re[i] = r * wRe[i] - m * wIm[i];
+        im[i] = r * wIm[i] + m * wRe[i];
+    }
+
+    sumX = px;
+    sumY = py;
+}
+
+inline void epicycle_rotate(EpicycleKernel kernel, float *re, float *im, const float *wRe, const float *wIm,
+                            size_t count, float& sumX, float& sumY)
+{
+    switch (kernel)
+    {
+#if defined(EPICYCLE_X86) && defined(__GNUC__)
+    case EPICYCLE_AVX2:
+        epicycle_rotate_avx2(re, im, wRe, wIm, count, sumX, sumY);
+        return;
+#endif
+#if defined(EPICYCLE_X86) && defined(__SSE2__)
+    case EPICYCLE_SSE2:
+        epicycle_rotate_sse2(re, im, wRe, wIm, count, sumX, sumY);
+        return;
+#endif
+#if defined(EPICYCLE_NEON)
+    case EPICYCLE_NEON:
+        epicycle_rotate_neon(re, im, wRe, wIm, count, sumX, sumY);
+        return;
+#endif
+    default:
+        epicycle_rotate_scalar(re, im, wRe, wIm, count, sumX, sumY);
+        return;
+    }
+}
+
+// The epicycle chain in fixed point, stored as struct of arrays: start phase,
+// integer frequency and radius in, current angle, cos, sin and centre out.
+// Every array is 64 byte aligned and padded to EPICYCLE_BLOCK circles of
+// radius 0, so the kernels never need a scalar tail.
+class PhaseEngine
+{
+public:
+    PhaseEngine() = default;
+
+    ~PhaseEngine()
+    {
+        free(memory);
+    }
+
+    // C is anything with starting_angle, frequency and radius (Circle)
+    template <typename C>
+    void load(const std::vector<C>& circles)
+    {
+        resize(circles.size());
+        for (size_t i = 0; i < n; i++)
+        {
+            startPhase[i] = phase_from_angle(circles[i].starting_angle);
+            frequency[i] = (int32_t)std::lround(circles[i].frequency);
+            radius[i] = circles[i].radius;
+        }
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    // Only the first count circles are evaluated from now on (rounded up to
+    // EPICYCLE_BLOCK), the tip is then theirs; see ChainLod. load() resets it.
+    void limit(size_t count)
+    {
+        active = std::min(padded, (count + EPICYCLE_BLOCK - 1) / EPICYCLE_BLOCK * EPICYCLE_BLOCK);
+    }
+
+    // circles the last evaluate() filled in
+    size_t activeSize() const
+    {
+        return std::min(n, active);
+    }
+
+    // Phase of circle i at the given tick, exact mod 2^32
+    uint32_t phase(size_t i, uint64_t tick) const
+    {
+        uint32_t base = (uint32_t)(tick * PHASE_BASE_STEP);
+        return startPhase[i] + (uint32_t)frequency[i] * base;
+    }
+
+    // Fills angle, cos, sin and centre of every circle for this tick with
+    // epicycle_kernel() (the best one the CPU has unless overridden)
+    void evaluate(uint64_t tick)
+    {
+        evaluate(tick, epicycle_kernel());
+    }
+
+    void evaluate(uint64_t tick, EpicycleKernel kernel)
+    {
+        EpicycleArrays a;
+        a.startPhase = startPhase;
+        a.frequency = frequency;
+        a.radius = radius;
+        a.angle = angleOut;
+        a.cosine = cosOut;
+        a.sine = sinOut;
+        a.x = xOut;
+        a.y = yOut;
+        a.count = active;
+        epicycle_evaluate(kernel, a, (uint32_t)(tick * PHASE_BASE_STEP), tip[0], tip[1]);
+    }
+
+    // Same, split across the pool as a blocked two-pass scan. Pass one runs
+    // the kernel on every chunk from a zero start, which leaves each chunk's
+    // own vector sum behind; a serial scan over those few sums gives every
+    // chunk its offset; pass two adds the offset and hands the finished range
+    // to emit(first, count) on the same thread while it is still in cache, so
+    // the caller can write its instance data there instead of in another loop.
+    // Chunks are whole cache lines, no two threads write the same one.
+    template <typename Emit>
+    void evaluate(uint64_t tick, ThreadPool& pool, Emit emit)
+    {
+        EpicycleKernel kernel = epicycle_kernel();
+        int chunks = pool.size();
+        size_t used = activeSize();
+        if (chunks <= 1 || active < parallelCutoff)
+        {
+            evaluate(tick, kernel);
+            emit(size_t(0), used);
+            return;
+        }
+
+        size_t chunk = (active / chunks + EPICYCLE_BLOCK - 1) / EPICYCLE_BLOCK * EPICYCLE_BLOCK;
+        chunks = (int)((active + chunk - 1) / chunk);
+        partial.resize(chunks);
+        uint32_t base = (uint32_t)(tick * PHASE_BASE_STEP);
+
+        pool.parallelFor(chunks, [&](int c) {
+            size_t first = c * chunk;
+            EpicycleArrays a;
+            a.startPhase = startPhase + first;
+            a.frequency = frequency + first;
+            a.radius = radius + first;
+            a.angle = angleOut + first;
+            a.cosine = cosOut + first;
+            a.sine = sinOut + first;
+            a.x = xOut + first;
+            a.y = yOut + first;
+            a.count = std::min(chunk, active - first);
+            epicycle_evaluate(kernel, a, base, partial[c].x, partial[c].y);
+        });
+
+        float ox = 0, oy = 0;
+        for (int c = 0; c < chunks; c++)
+        {
+            float sx = partial[c].x, sy = partial[c].y;
+            partial[c].x = ox;
+            partial[c].y = oy;
+            ox += sx;
+            oy += sy;
+        }
+        tip[0] = ox;
+        tip[1] = oy;
+
+        pool.parallelFor(chunks, [&](int c) {
+            size_t first = c * chunk;
+            size_t last = std::min(first + chunk, active);
+            float dx = partial[c].x, dy = partial[c].y;
+            for (size_t i = first; i < last; i++)
+            {
+                xOut[i] += dx;
+                yOut[i] += dy;
+            }
+            if (first < used)
+                emit(first, std::min(last, used) - first);
+        });
+    }
+
+    // below this many circles one thread beats the two passes
+    size_t parallelCutoff = 1 << 15;
+
+    const float *x() const { return xOut; }
+    const float *y() const { return yOut; }
+    const float *angle() const { return angleOut; }
+    const float *cosine() const { return cosOut; }
+    const float *sine() const { return sinOut; }
+    float tipX() const { return tip[0]; }
+    float tipY() const { return tip[1]; }
+
+private:
+    PhaseEngine(const PhaseEngine&) = delete;
+    PhaseEngine& operator=(const PhaseEngine&) = delete;
+
+    // one allocation, carved into the eight arrays
+    void resize(size_t count)
+    {
+        n = count;
+        size_t want = (count + EPICYCLE_BLOCK - 1) / EPICYCLE_BLOCK * EPICYCLE_BLOCK;
+        if (want > capacity || !memory)
+        {
+            free(memory);
+            memory = NULL;
+            if (posix_memalign(&memory, 64, 8 * sizeof(float) * (want ? want : EPICYCLE_BLOCK)) != 0)
+                memory = NULL;
+            capacity = want;
+        }
+        padded = want;
+        active = want;
+
+        char *p = (char*)memory;
+        size_t bytes = sizeof(float) * capacity;
+        startPhase = (uint32_t*)p;  p += bytes;
+        frequency  = (int32_t*)p;   p += bytes;
+        radius     = (float*)p;     p += bytes;
+        angleOut   = (float*)p;     p += bytes;
+        cosOut     = (float*)p;     p += bytes;
+        sinOut     = (float*)p;     p += bytes;
+        xOut       = (float*)p;     p += bytes;
+        yOut       = (float*)p;
+
+        // padding circles have radius 0, they add nothing to the chain
+        memset(startPhase, 0, bytes);
+        memset(frequency, 0, bytes);
+        memset(radius, 0, bytes);
+    }
+
+    void *memory = NULL;
+    size_t n = 0;
+    size_t padded = 0;
+    size_t active = 0;
+    size_t capacity = 0;
+
+    uint32_t *startPhase = NULL;
+    int32_t *frequency = NULL;
+    float *radius = NULL;
+    float *angleOut = NULL;
+    float *cosOut = NULL;
+    float *sinOut = NULL;
+    float *xOut = NULL;
+    float *yOut = NULL;
+
+    float tip[2] = {0, 0};
+
+    struct alignas(64) ChunkSum
+    {
+        float x, y;
+    };
+    std::vector<ChunkSum> partial;
+};
+
+#endif
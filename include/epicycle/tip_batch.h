@@ -0,0 +1,364 @@
+#ifndef TIP_BATCH_H
+#define TIP_BATCH_H
+
+#include <fft/fft.h>
+#include <epicycle/phase_engine.h>
+#include <thread_pool/thread_pool.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// The chain's tip at many times at once, for exporting a path or filling a
+// trail. The tip at tick t is sum_i r_i exp(i (theta_i + f_i phi(t))), a
+// complex matrix-vector product between the T x N phase matrix and the
+// coefficients, and there are three ways to do it:
+//
+//   direct      any times. Tiled so a block of TIP_CIRCLE_TILE coefficients
+//               stays in L1 while a block of TIP_TIME_TILE times runs over it
+//               with the epicycle_sum_* SIMD kernels; T x N sin/cos.
+//   recurrence  evenly spaced times. Every circle turns by the same
+//               exp(i f delta) per step, so after one exact start a step is a
+//               complex multiply per circle, no sin/cos. Restarted from the
+//               exact phase every TIP_RESYNC steps so float rounding can't
+//               build up (the same scheme as pruned_sum).
+//   ifft        evenly spaced times whose fixed-point step delta divides a
+//               turn into M <= TIP_FFT_MAX equal parts. Then phase f * delta
+//               is exactly bin f * (delta / (2^32 / M)) mod M of an M-point
+//               grid and all T tips are one inverse FFT, read periodically.
+//
+// evaluate() detects even spacing and picks by estimated cost unless told
+// otherwise. Direct and recurrence run on the thread pool, split over time
+// tiles and, when there are too few of those, over circle ranges as well.
+
+enum TipMethod
+{
+    TIP_AUTO,
+    TIP_DIRECT,
+    TIP_RECURRENCE,
+    TIP_IFFT
+};
+
+inline const char *tip_method_name(TipMethod method)
+{
+    switch (method)
+    {
+    case TIP_DIRECT:     return "direct";
+    case TIP_RECURRENCE: return "recurrence";
+    case TIP_IFFT:       return "ifft";
+    default:             return "auto";
+    }
+}
+
+// 2048 circles are 24 KB of phase, frequency and radius
+const size_t TIP_CIRCLE_TILE = 2048;
+const size_t TIP_TIME_TILE = 32;
+const size_t TIP_RESYNC = 256;
+const uint32_t TIP_FFT_MAX = 1u << 20;
+
+// Cost per circle and time relative to one direct evaluation (a polynomial
+// sin/cos), and per point and stage of the inverse FFT. From "./benchmark tips".
+const double TIP_COST_RECURRENCE = 0.2;
+const double TIP_COST_FFT = 1.5;
+
+class TipBatch
+{
+public:
+    TipBatch() = default;
+
+    ~TipBatch()
+    {
+        free(memory);
+    }
+
+    // C is anything with starting_angle, frequency and radius (Circle)
+    template <typename C>
+    void load(const std::vector<C>& circles)
+    {
+        resize(circles.size());
+        double turn = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            startPhase[i] = phase_from_angle(circles[i].starting_angle);
+            frequency[i] = (int32_t)std::lround(circles[i].frequency);
+            radius[i] = circles[i].radius;
+            turn += std::fabs(double(frequency[i]) * radius[i]);
+        }
+        // circle i's end moves at |f_i| r_i times the base angular speed
+        speed = turn * 2.0 * M_PI * PHASE_BASE_STEP / 4294967296.0;
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    // The most the tip can move in one tick, world units
+    double tickSpeed() const
+    {
+        return speed;
+    }
+
+    // true when ticks[k] = ticks[0] + k * step for every k
+    static bool uniform(const uint64_t *ticks, size_t count, uint64_t& step)
+    {
+        step = count > 1 ? ticks[1] - ticks[0] : 0;
+        for (size_t k = 2; k < count; k++)
+        {
+            if (ticks[k] - ticks[k - 1] != step)
+                return false;
+        }
+        return true;
+    }
+
+    // Tip position at each of the count ticks (see phase_ticks) into x, y.
+    // Returns the method that ran; one that doesn't apply to these times
+    // (recurrence or ifft on uneven ones, ifft on a step that needs more than
+    // TIP_FFT_MAX points) falls back to the next best that does.
+    TipMethod evaluate(const uint64_t *ticks, size_t count, float *x, float *y,
+                       ThreadPool& pool, TipMethod method = TIP_AUTO)
+    {
+        if (!count)
+            return method;
+
+        uint64_t step = 0;
+        bool even = count > 2 && uniform(ticks, count, step);
+        uint32_t delta = (uint32_t)(step * PHASE_BASE_STEP);
+        // points in a turn, in 64 bits: an odd delta needs all 2^32
+        uint64_t M = 0;
+        if (even)
+            M = delta ? uint64_t(1) << (32 - __builtin_ctz(delta)) : 1u;
+        bool fftFits = even && M && M <= TIP_FFT_MAX;
+
+        if (!even)
+            method = TIP_DIRECT;
+        else if (method == TIP_IFFT && !fftFits)
+            method = TIP_RECURRENCE;
+        else if (method == TIP_AUTO)
+        {
+            double T = double(count), N = double(padded);
+            double direct = T * N;
+            double recurrence = T * N * TIP_COST_RECURRENCE + N * std::ceil(T / TIP_RESYNC) * 2.0;
+            double ifft = fftFits ? N + T + M * std::log2(double(M) + 1) * TIP_COST_FFT : direct + 1;
+            method = TIP_DIRECT;
+            if (recurrence < direct)
+                method = TIP_RECURRENCE;
+            if (ifft < std::min(direct, recurrence))
+                method = TIP_IFFT;
+        }
+
+        if (method == TIP_IFFT)
+            evaluateFFT(ticks[0], delta, (uint32_t)M, count, x, y);
+        else
+            evaluateTiled(method, ticks, count, delta, x, y, pool);
+        return method;
+    }
+
+private:
+    TipBatch(const TipBatch&) = delete;
+    TipBatch& operator=(const TipBatch&) = delete;
+
+    void evaluateTiled(TipMethod method, const uint64_t *ticks, size_t count, uint32_t delta,
+                       float *x, float *y, ThreadPool& pool)
+    {
+        const EpicycleKernel kernel = epicycle_kernel();
+        const size_t timeTile = method == TIP_RECURRENCE ? TIP_RESYNC : TIP_TIME_TILE;
+        const size_t timeTiles = (count + timeTile - 1) / timeTile;
+        const size_t circleTiles = std::max<size_t>(1, (padded + TIP_CIRCLE_TILE - 1) / TIP_CIRCLE_TILE);
+
+        // enough tasks for every thread even when there are only a few times
+        size_t splits = ((size_t)pool.size() * 2 + timeTiles - 1) / timeTiles;
+        splits = std::max<size_t>(1, std::min(splits, circleTiles));
+
+        partial.assign(splits * 2 * count, 0.0);
+
+        pool.parallelFor((int)(timeTiles * splits), [&](int task) {
+            size_t k0 = (task / splits) * timeTile;
+            size_t k1 = std::min(count, k0 + timeTile);
+            size_t split = task % splits;
+            size_t t0 = circleTiles * split / splits;
+            size_t t1 = circleTiles * (split + 1) / splits;
+            double *sum = partial.data() + split * 2 * count;
+
+            for (size_t tile = t0; tile < t1; tile++)
+            {
+                size_t first = tile * TIP_CIRCLE_TILE;
+                size_t len = std::min(TIP_CIRCLE_TILE, padded - first);
+                if (method == TIP_RECURRENCE)
+                    recurrenceTile(kernel, first, len, ticks[k0], delta, k1 - k0, sum + 2 * k0);
+                else
+                    directTile(kernel, first, len, ticks + k0, k1 - k0, sum + 2 * k0);
+            }
+        });
+
+        for (size_t k = 0; k < count; k++)
+        {
+            double sx = 0, sy = 0;
+            for (size_t s = 0; s < splits; s++)
+            {
+                sx += partial[s * 2 * count + 2 * k];
+                sy += partial[s * 2 * count + 2 * k + 1];
+            }
+            x[k] = float(sx);
+            y[k] = float(sy);
+        }
+    }
+
+    // one coefficient tile against a run of times, the tile stays in cache
+    void directTile(EpicycleKernel kernel, size_t first, size_t len,
+                    const uint64_t *ticks, size_t count, double *sum) const
+    {
+        EpicycleArrays a = arrays(first, len);
+        for (size_t k = 0; k < count; k++)
+        {
+            float sx, sy;
+            epicycle_sum(kernel, a, (uint32_t)(ticks[k] * PHASE_BASE_STEP), sx, sy);
+            sum[2 * k] += sx;
+            sum[2 * k + 1] += sy;
+        }
+    }
+
+    // count evenly spaced steps from tick, exact start and step from the kernel
+    void recurrenceTile(EpicycleKernel kernel, size_t first, size_t len,
+                        uint64_t tick, uint32_t delta, size_t count, double *sum) const
+    {
+        static thread_local std::vector<float> scratch;
+        scratch.resize(9 * TIP_CIRCLE_TILE + 16);
+        float *base = (float*)(((uintptr_t)scratch.data() + 63) & ~(uintptr_t)63);
+        float *zRe = base, *zIm = zRe + TIP_CIRCLE_TILE;
+        float *wRe = zIm + TIP_CIRCLE_TILE, *wIm = wRe + TIP_CIRCLE_TILE;
+
+        // the kernel writes cos, sin and the unused angle and centres here
+        EpicycleArrays a = arrays(first, len);
+        a.angle = wIm + TIP_CIRCLE_TILE;
+        a.x = a.angle + TIP_CIRCLE_TILE;
+        a.y = a.x + TIP_CIRCLE_TILE;
+        float unused[2];
+
+        a.cosine = zRe;
+        a.sine = zIm;
+        epicycle_evaluate(kernel, a, (uint32_t)(tick * PHASE_BASE_STEP), unused[0], unused[1]);
+        for (size_t i = 0; i < len; i++)
+        {
+            zRe[i] *= radius[first + i];
+            zIm[i] *= radius[first + i];
+        }
+
+        // exp(i f delta): the same kernel with every start phase at zero
+        a.startPhase = zeroPhase;
+        a.cosine = wRe;
+        a.sine = wIm;
+        epicycle_evaluate(kernel, a, delta, unused[0], unused[1]);
+
+        for (size_t k = 0; k < count; k++)
+        {
+            float sx, sy;
+            epicycle_rotate(kernel, zRe, zIm, wRe, wIm, len, sx, sy);
+            sum[2 * k] += sx;
+            sum[2 * k + 1] += sy;
+        }
+    }
+
+    // tip k = inverse DFT of the coefficients at bin f * j mod M, j = delta / (2^32 / M)
+    void evaluateFFT(uint64_t tick, uint32_t delta, uint32_t M, size_t count, float *x, float *y)
+    {
+        typedef FFTW<float>::complex complex_t;
+        uint32_t base = (uint32_t)(tick * PHASE_BASE_STEP);
+        uint32_t j = delta ? delta >> __builtin_ctz(delta) : 0;
+
+        std::vector<double> spectrum(2 * (size_t)M, 0.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t p = startPhase[i] + (uint32_t)frequency[i] * base;
+            uint32_t bin = ((uint32_t)frequency[i] * j) & (M - 1);
+            double angle = double(int32_t(p)) * (2.0 * M_PI / 4294967296.0);
+            spectrum[2 * bin] += radius[i] * std::cos(angle);
+            spectrum[2 * bin + 1] += radius[i] * std::sin(angle);
+        }
+
+        if (M == 1)
+        {
+            for (size_t k = 0; k < count; k++)
+            {
+                x[k] = float(spectrum[0]);
+                y[k] = float(spectrum[1]);
+            }
+            return;
+        }
+
+        complex_t *in = (complex_t*) FFTW<float>::malloc(sizeof(complex_t) * M);
+        complex_t *out = (complex_t*) FFTW<float>::malloc(sizeof(complex_t) * M);
+        for (uint32_t b = 0; b < M; b++)
+        {
+            in[b][0] = float(spectrum[2 * b]);
+            in[b][1] = float(spectrum[2 * b + 1]);
+        }
+
+        fft_execute((int)M, FFTW_BACKWARD, in, out);
+
+        for (size_t k = 0; k < count; k++)
+        {
+            x[k] = out[k & (M - 1)][0];
+            y[k] = out[k & (M - 1)][1];
+        }
+
+        FFTW<float>::free(in);
+        FFTW<float>::free(out);
+    }
+
+    EpicycleArrays arrays(size_t first, size_t len) const
+    {
+        EpicycleArrays a;
+        a.startPhase = startPhase + first;
+        a.frequency = frequency + first;
+        a.radius = radius + first;
+        a.angle = a.cosine = a.sine = a.x = a.y = NULL;
+        a.count = len;
+        return a;
+    }
+
+    // one allocation for the four arrays, like PhaseEngine
+    void resize(size_t count)
+    {
+        n = count;
+        size_t want = (count + EPICYCLE_BLOCK - 1) / EPICYCLE_BLOCK * EPICYCLE_BLOCK;
+        if (want > capacity || !memory)
+        {
+            free(memory);
+            memory = NULL;
+            if (posix_memalign(&memory, 64, 4 * sizeof(float) * (want ? want : EPICYCLE_BLOCK)) != 0)
+                memory = NULL;
+            capacity = want;
+        }
+        padded = want;
+
+        char *p = (char*)memory;
+        size_t bytes = sizeof(float) * capacity;
+        startPhase = (uint32_t*)p;  p += bytes;
+        frequency  = (int32_t*)p;   p += bytes;
+        radius     = (float*)p;     p += bytes;
+        zeroPhase  = (uint32_t*)p;
+
+        memset(memory, 0, 4 * bytes);
+    }
+
+    void *memory = NULL;
+    size_t n = 0;
+    size_t padded = 0;
+    double speed = 0;
+    size_t capacity = 0;
+
+    uint32_t *startPhase = NULL;
+    int32_t *frequency = NULL;
+    float *radius = NULL;
+    uint32_t *zeroPhase = NULL;
+
+    std::vector<double> partial;
+};
+
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef BATCH_FFT_H
+#define BATCH_FFT_H
+
+#include <fftw/fftw3.h>
+#include <fft/fftw_traits.h>
+#include <fft/plan_cache.h>
+#include <fft/threaded_fft.h>
+#include <fft/fft.h>
+#include <thread_pool/thread_pool.h>
+
+#include <algorithm>
+#include <vector>
+
+
+// FFTW side of fft_batch_execute. Big batches are split into one contiguous
+// run of shapes per thread. The plans for those runs are made up front so the
+// workers only execute.
+template <typename T>
+void fft_batch_execute_fftw(int K, int N, int direction, T (*in)[2], T (*out)[2])
+{
+    typedef FFTW<T> api;
+    PlanCacheT<T>& cache = PlanCacheT<T>::instance();
+    FFTThreadConfig& config = fft_thread_config();
+
+    int threads = config.threads;
+    if (threads <= 1 || K < threads || (long long)K * N < config.serialCutoff)
+    {
+        typename api::plan p = cache.getMany(N, K, direction, in, out);
+        api::execute_dft(p, in, out);
+        return;
+    }
+
+    int chunk = (K + threads - 1) / threads;
+
+    // in + s * N is not always fftw_malloc aligned, so each run looks up its
+    // own plan (the cache keys on alignment and batch size)
+    std::vector<typename api::plan> plans(threads, NULL);
+    for (int c = 0; c < threads; c++)
+    {
+        int first = c * chunk;
+        int count = std::min(chunk, K - first);
+        if (count > 0)
+            plans[c] = cache.getMany(N, count, direction, in + (size_t)first * N, out + (size_t)first * N);
+    }
+
+    ThreadPool& pool = ThreadPool::instance();
+    if (pool.size() != threads)
+        pool.resize(threads);
+
+    pool.parallelFor(threads, [&](int c) {
+        int first = c * chunk;
+        int count = std::min(chunk, K - first);
+        if (count <= 0)
+            return;
+        api::execute_dft(plans[c], in + (size_t)first * N, out + (size_t)first * N);
+    });
+}
+
+// Transforms K paths of N samples each with one plan_many_dft instead of K
+// single transforms. Both buffers hold the shapes back to back (shape s at
+// [s * N, (s + 1) * N)), so coefficient set s is exactly the instance range
+// [s * N, (s + 1) * N) of a single instanced draw.
+template <typename T>
+void fft_batch_execute(int K, int N, int direction, T (*in)[2], T (*out)[2])
+{
+#ifndef FFT_NO_FFTW
+    if (fft_backend() == FFT_BACKEND_FFTW)
+    {
+        fft_batch_execute_fftw(K, N, direction, in, out);
+        return;
+    }
+#endif
+    // the builtin engine has no batched kernel, its plan is at least shared
+    for (int s = 0; s < K; s++)
+        fft_execute(N, direction, in + (size_t)s * N, out + (size_t)s * N);
+}
+
+
+#endif
@@ -0,0 +1,689 @@
+#ifndef BUILTIN_FFT_H
+#define BUILTIN_FFT_H
+
+#include <cmath>
+#include <stdlib.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define FFT_AVX 1
+#endif
+
+
+// Self-contained FFT used when the project is built without libfftw3
+// (-DFFT_NO_FFTW) or when fft_backend() is set to FFT_BACKEND_BUILTIN.
+//
+// Powers of two run an iterative decimation-in-time FFT on split re/im arrays,
+// two radix-2 stages fused into one radix-4 pass so the data is swept half as
+// often. The inner loops walk contiguous twiddles and data, so they map onto
+// SIMD registers directly: SSE2 or NEON, whichever the compiler targets, and
+// on x86 AVX when the CPU has it, whatever the build flags (see fft_simd()).
+// Any other N goes through Bluestein's algorithm on a power of two >= 2N - 1.
+//
+// Sign convention and scaling match FFTW: forward is exp(-2 pi i jk / N),
+// nothing is normalized.
+
+inline void *fft_aligned_malloc(size_t bytes)
+{
+    void *p = NULL;
+    if (posix_memalign(&p, 64, bytes ? bytes : 1) != 0)
+        return NULL;
+    return p;
+}
+
+inline void fft_aligned_free(void *p)
+{
+    free(p);
+}
+
+// -------------------- SIMD lanes --------------------
+template <typename T>
+struct FFTLanes
+{
+    typedef T reg;
+    static const int width = 1;
+    static reg load(const T *p) { return *p; }
+    static void store(T *p, reg v) { *p = v; }
+    static reg add(reg a, reg b) { return a + b; }
+    static reg sub(reg a, reg b) { return a - b; }
+    static reg mul(reg a, reg b) { return a * b; }
+};
+
+#if defined(__SSE2__)
+template <>
+struct FFTLanes<double>
+{
+    typedef __m128d reg;
+    static const int width = 2;
+    static reg load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, reg v) { _mm_storeu_pd(p, v); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+};
+
+template <>
+struct FFTLanes<float>
+{
+    typedef __m128 reg;
+    static const int width = 4;
+    static reg load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, reg v) { _mm_storeu_ps(p, v); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+};
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+template <>
+struct FFTLanes<double>
+{
+    typedef float64x2_t reg;
+    static const int width = 2;
+    static reg load(const double *p) { return vld1q_f64(p); }
+    static void store(double *p, reg v) { vst1q_f64(p, v); }
+    static reg add(reg a, reg b) { return vaddq_f64(a, b); }
+    static reg sub(reg a, reg b) { return vsubq_f64(a, b); }
+    static reg mul(reg a, reg b) { return vmulq_f64(a, b); }
+};
+
+template <>
+struct FFTLanes<float>
+{
+    typedef float32x4_t reg;
+    static const int width = 4;
+    static reg load(const float *p) { return vld1q_f32(p); }
+    static void store(float *p, reg v) { vst1q_f32(p, v); }
+    static reg add(reg a, reg b) { return vaddq_f32(a, b); }
+    static reg sub(reg a, reg b) { return vsubq_f32(a, b); }
+    static reg mul(reg a, reg b) { return vmulq_f32(a, b); }
+};
+#endif
+
+#ifdef FFT_AVX
+// Compiled for AVX whatever the build flags, only called when the CPU has it
+#define FFT_AVX_TARGET __attribute__((target("avx")))
+
+template <typename T>
+struct FFTLanesAvx;
+
+template <>
+struct FFTLanesAvx<double>
+{
+    typedef __m256d reg;
+    static const int width = 4;
+    FFT_AVX_TARGET static reg set1(double v) { return _mm256_set1_pd(v); }
+    FFT_AVX_TARGET static reg load(const double *p) { return _mm256_loadu_pd(p); }
+    FFT_AVX_TARGET static void store(double *p, reg v) { _mm256_storeu_pd(p, v); }
+    FFT_AVX_TARGET static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    FFT_AVX_TARGET static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    FFT_AVX_TARGET static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+};
+
+template <>
+struct FFTLanesAvx<float>
+{
+    typedef __m256 reg;
+    static const int width = 8;
+    FFT_AVX_TARGET static reg set1(float v) { return _mm256_set1_ps(v); }
+    FFT_AVX_TARGET static reg load(const float *p) { return _mm256_loadu_ps(p); }
+    FFT_AVX_TARGET static void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+    FFT_AVX_TARGET static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    FFT_AVX_TARGET static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    FFT_AVX_TARGET static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+};
+#endif
+
+enum FFTSimd
+{
+    FFT_SIMD_BASELINE,          // FFTLanes: SSE2, NEON or scalar, from the build flags
+    FFT_SIMD_AVX
+};
+
+inline const char *fft_simd_name(FFTSimd simd)
+{
+    if (simd == FFT_SIMD_AVX)
+        return "avx";
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+inline bool fft_simd_supported(FFTSimd simd)
+{
+#ifdef FFT_AVX
+    if (simd == FFT_SIMD_AVX)
+        return __builtin_cpu_supports("avx");
+#endif
+    return simd == FFT_SIMD_BASELINE;
+}
+
+// Picked once per process from the CPU, like epicycle_kernel() it can be
+// overridden
+inline FFTSimd& fft_simd()
+{
+    static FFTSimd simd = fft_simd_supported(FFT_SIMD_AVX) ? FFT_SIMD_AVX : FFT_SIMD_BASELINE;
+    return simd;
+}
+
+// -------------------- power of two kernel --------------------
+template <typename T>
+class Radix4FFT
+{
+public:
+    Radix4FFT(int N, int direction)
+        : N(N)
+    {
+        sign = (direction < 0) ? -1.0 : 1.0;
+
+        logN = 0;
+        while ((1 << logN) < N)
+            logN++;
+
+        reversed.resize(N);
+        for (int i = 0; i < N; i++)
+        {
+            int r = 0;
+            for (int b = 0; b < logN; b++)
+                r |= ((i >> b) & 1) << (logN - 1 - b);
+            reversed[i] = r;
+        }
+
+        // per pass twiddles, stored split so the butterflies read them contiguously
+        int m = 1;
+        while (4 * m <= N)
+        {
+            Pass pass;
+            pass.m = m;
+            pass.radix4 = true;
+            fillTwiddles(pass.w1re, pass.w1im, m, 2 * m);
+            fillTwiddles(pass.w2re, pass.w2im, m, 4 * m);
+            passes.push_back(pass);
+            m *= 4;
+        }
+        if (m < N)
+        {
+            Pass pass;
+            pass.m = m;
+            pass.radix4 = false;
+            fillTwiddles(pass.w1re, pass.w1im, m, 2 * m);
+            passes.push_back(pass);
+        }
+
+        re = (T*) fft_aligned_malloc(sizeof(T) * N);
+        im = (T*) fft_aligned_malloc(sizeof(T) * N);
+    }
+
+    ~Radix4FFT()
+    {
+        fft_aligned_free(re);
+        fft_aligned_free(im);
+    }
+
+    // interleaved in/out like fftw_complex, in == out is fine
+    void execute(const T (*in)[2], T (*out)[2])
+    {
+        for (int i = 0; i < N; i++)
+        {
+            re[reversed[i]] = in[i][0];
+            im[reversed[i]] = in[i][1];
+        }
+
+        run();
+
+        for (int i = 0; i < N; i++)
+        {
+            out[i][0] = re[i];
+            out[i][1] = im[i];
+        }
+    }
+
+    // split in/out, already in natural order; used by Bluestein
+    void executeSplit(T *dataRe, T *dataIm)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            re[reversed[i]] = dataRe[i];
+            im[reversed[i]] = dataIm[i];
+        }
+
+        run();
+
+        for (int i = 0; i < N; i++)
+        {
+            dataRe[i] = re[i];
+            dataIm[i] = im[i];
+        }
+    }
+
+private:
+    Radix4FFT(const Radix4FFT&) = delete;
+    Radix4FFT& operator=(const Radix4FFT&) = delete;
+
+    struct Pass
+    {
+        int m;
+        bool radix4;
+        std::vector<T> w1re, w1im;      // W_{2m}^j
+        std::vector<T> w2re, w2im;      // W_{4m}^j, radix 4 only
+    };
+
+    void fillTwiddles(std::vector<T>& wr, std::vector<T>& wi, int count, int L)
+    {
+        wr.resize(count);
+        wi.resize(count);
+        for (int j = 0; j < count; j++)
+        {
+            double a = sign * 2.0 * M_PI * j / L;
+            wr[j] = T(std::cos(a));
+            wi[j] = T(std::sin(a));
+        }
+    }
+
+    void run()
+    {
+#ifdef FFT_AVX
+        if (fft_simd() == FFT_SIMD_AVX)
+        {
+            runAvx();
+            return;
+        }
+#endif
+        for (const Pass& pass : passes)
+        {
+            if (pass.radix4)
+                radix4Pass(pass);
+            else
+                radix2Pass(pass);
+        }
+    }
+
+    void radix2Pass(const Pass& pass)
+    {
+        typedef FFTLanes<T> L;
+        int m = pass.m;
+        const T *wr = pass.w1re.data();
+        const T *wi = pass.w1im.data();
+
+        for (int k = 0; k < N; k += 2 * m)
+        {
+            T *ar = re + k, *ai = im + k;
+            T *br = re + k + m, *bi = im + k + m;
+            int j = 0;
+            for (; j + L::width <= m; j += L::width)
+            {
+                typename L::reg xr = L::load(br + j), xi = L::load(bi + j);
+                typename L::reg cr = L::load(wr + j), ci = L::load(wi + j);
+                typename L::reg tr = L::sub(L::mul(xr, cr), L::mul(xi, ci));
+                typename L::reg ti = L::add(L::mul(xr, ci), L::mul(xi, cr));
+                typename L::reg pr = L::load(ar + j), pi = L::load(ai + j);
+                L::store(ar + j, L::add(pr, tr));
+                L::store(ai + j, L::add(pi, ti));
+                L::store(br + j, L::sub(pr, tr));
+                L::store(bi + j, L::sub(pi, ti));
+            }
+            for (; j < m; j++)
+            {
+                T tr = br[j] * wr[j] - bi[j] * wi[j];
+                T ti = br[j] * wi[j] + bi[j] * wr[j];
+                T pr = ar[j], pi = ai[j];
+                ar[j] = pr + tr;
+                ai[j] = pi + ti;
+                br[j] = pr - tr;
+                bi[j] = pi - ti;
+            }
+        }
+    }
+
+    // Two fused DIT stages (half sizes m and 2m). With a, b, c, d the four
+    // quarter blocks:
+    //   a1 = a + w1 b   b1 = a - w1 b   c1 = c + w1 d   d1 = c - w1 d
+    //   a = a1 + w2 c1  c = a1 - w2 c1  b = b1 + s*i w2 d1   d = b1 - s*i w2 d1
+    // where w1 = W_2m^j, w2 = W_4m^j and s*i = W_4 is the sign-dependent quarter turn.
+    void radix4Pass(const Pass& pass)
+    {
+        typedef FFTLanes<T> L;
+        typedef typename L::reg R;
+        int m = pass.m;
+        const T *w1r = pass.w1re.data(), *w1i = pass.w1im.data();
+        const T *w2r = pass.w2re.data(), *w2i = pass.w2im.data();
+        T s = T(sign);
+
+        for (int k = 0; k < N; k += 4 * m)
+        {
+            T *ar = re + k,         *ai = im + k;
+            T *br = re + k + m,     *bi = im + k + m;
+            T *cr = re + k + 2 * m, *ci = im + k + 2 * m;
+            T *dr = re + k + 3 * m, *di = im + k + 3 * m;
+
+            int j = 0;
+            if (m >= L::width)
+            {
+                R vs = broadcast(s);
+                for (; j + L::width <= m; j += L::width)
+                {
+                    R xr1 = L::load(w1r + j), xi1 = L::load(w1i + j);
+                    R xr2 = L::load(w2r + j), xi2 = L::load(w2i + j);
+
+                    R Ar = L::load(ar + j), Ai = L::load(ai + j);
+                    R Br = L::load(br + j), Bi = L::load(bi + j);
+                    R Cr = L::load(cr + j), Ci = L::load(ci + j);
+                    R Dr = L::load(dr + j), Di = L::load(di + j);
+
+                    R tbr = L::sub(L::mul(Br, xr1), L::mul(Bi, xi1));
+                    R tbi = L::add(L::mul(Br, xi1), L::mul(Bi, xr1));
+                    R tdr = L::sub(L::mul(Dr, xr1), L::mul(Di, xi1));
+                    R tdi = L::add(L::mul(Dr, xi1), L::mul(Di, xr1));
+
+                    R a1r = L::add(Ar, tbr), a1i = L::add(Ai, tbi);
+                    R b1r = L::sub(Ar, tbr), b1i = L::sub(Ai, tbi);
+                    R c1r = L::add(Cr, tdr), c1i = L::add(Ci, tdi);
+                    R d1r = L::sub(Cr, tdr), d1i = L::sub(Ci, tdi);
+
+                    R tcr = L::sub(L::mul(c1r, xr2), L::mul(c1i, xi2));
+                    R tci = L::add(L::mul(c1r, xi2), L::mul(c1i, xr2));
+                    R ur  = L::sub(L::mul(d1r, xr2), L::mul(d1i, xi2));
+                    R ui  = L::add(L::mul(d1r, xi2), L::mul(d1i, xr2));
+                    // (ur + i ui) * (s i) = -s ui + i s ur
+                    R tdr2 = L::sub(broadcast(T(0)), L::mul(vs, ui));
+                    R tdi2 = L::mul(vs, ur);
+
+                    L::store(ar + j, L::add(a1r, tcr));
+                    L::store(ai + j, L::add(a1i, tci));
+                    L::store(cr + j, L::sub(a1r, tcr));
+                    L::store(ci + j, L::sub(a1i, tci));
+                    L::store(br + j, L::add(b1r, tdr2));
+                    L::store(bi + j, L::add(b1i, tdi2));
+                    L::store(dr + j, L::sub(b1r, tdr2));
+                    L::store(di + j, L::sub(b1i, tdi2));
+                }
+            }
+            for (; j < m; j++)
+            {
+                T tbr = br[j] * w1r[j] - bi[j] * w1i[j];
+                T tbi = br[j] * w1i[j] + bi[j] * w1r[j];
+                T tdr = dr[j] * w1r[j] - di[j] * w1i[j];
+                T tdi = dr[j] * w1i[j] + di[j] * w1r[j];
+
+                T a1r = ar[j] + tbr, a1i = ai[j] + tbi;
+                T b1r = ar[j] - tbr, b1i = ai[j] - tbi;
+                T c1r = cr[j] + tdr, c1i = ci[j] + tdi;
+                T d1r = cr[j] - tdr, d1i = ci[j] - tdi;
+
+                T tcr = c1r * w2r[j] - c1i * w2i[j];
+                T tci = c1r * w2i[j] + c1i * w2r[j];
+                T ur  = d1r * w2r[j] - d1i * w2i[j];
+                T ui  = d1r * w2i[j] + d1i * w2r[j];
+                T tdr2 = -s * ui;
+                T tdi2 = s * ur;
+
+                ar[j] = a1r + tcr;
+                ai[j] = a1i + tci;
+                cr[j] = a1r - tcr;
+                ci[j] = a1i - tci;
+                br[j] = b1r + tdr2;
+                bi[j] = b1i + tdi2;
+                dr[j] = b1r - tdr2;
+                di[j] = b1i - tdi2;
+            }
+        }
+    }
+
+#ifdef FFT_AVX
+    // The same passes on 256-bit registers. The first ones are shorter than a
+    // register and stay on the baseline lanes; the rest have m a multiple of
+    // the width, so there is no scalar tail
+    FFT_AVX_TARGET void runAvx()
+    {
+        typedef FFTLanesAvx<T> L;
+        for (const Pass& pass : passes)
+        {
+            if (pass.m < L::width)
+            {
+                if (pass.radix4)
+                    radix4Pass(pass);
+                else
+                    radix2Pass(pass);
+            }
+            else if (pass.radix4)
+                radix4PassAvx(pass);
+            else
+                radix2PassAvx(pass);
+        }
+    }
+
+    FFT_AVX_TARGET void radix2PassAvx(const Pass& pass)
+    {
+        typedef FFTLanesAvx<T> L;
+        typedef typename L::reg R;
+        int m = pass.m;
+        const T *wr = pass.w1re.data();
+        const T *wi = pass.w1im.data();
+
+        for (int k = 0; k < N; k += 2 * m)
+        {
+            T *ar = re + k, *ai = im + k;
+            T *br = re + k + m, *bi = im + k + m;
+            for (int j = 0; j < m; j += L::width)
+            {
+                R xr = L::load(br + j), xi = L::load(bi + j);
+                R cr = L::load(wr + j), ci = L::load(wi + j);
+                R tr = L::sub(L::mul(xr, cr), L::mul(xi, ci));
+                R ti = L::add(L::mul(xr, ci), L::mul(xi, cr));
+                R pr = L::load(ar + j), pi = L::load(ai + j);
+                L::store(ar + j, L::add(pr, tr));
+                L::store(ai + j, L::add(pi, ti));
+                L::store(br + j, L::sub(pr, tr));
+                L::store(bi + j, L::sub(pi, ti));
+            }
+        }
+    }
+
+    FFT_AVX_TARGET void radix4PassAvx(const Pass& pass)
+    {
+        typedef FFTLanesAvx<T> L;
+        typedef typename L::reg R;
+        int m = pass.m;
+        const T *w1r = pass.w1re.data(), *w1i = pass.w1im.data();
+        const T *w2r = pass.w2re.data(), *w2i = pass.w2im.data();
+        R vs = L::set1(T(sign));
+        R zero = L::set1(T(0));
+
+        for (int k = 0; k < N; k += 4 * m)
+        {
+            T *ar = re + k,         *ai = im + k;
+            T *br = re + k + m,     *bi = im + k + m;
+            T *cr = re + k + 2 * m, *ci = im + k + 2 * m;
+            T *dr = re + k + 3 * m, *di = im + k + 3 * m;
+
+            for (int j = 0; j < m; j += L::width)
+            {
+                R xr1 = L::load(w1r + j), xi1 = L::load(w1i + j);
+                R xr2 = L::load(w2r + j), xi2 = L::load(w2i + j);
+
+                R Ar = L::load(ar + j), Ai = L::load(ai + j);
+                R Br = L::load(br + j), Bi = L::load(bi + j);
+                R Cr = L::load(cr + j), Ci = L::load(ci + j);
+                R Dr = L::load(dr + j), Di = L::load(di + j);
+
+                R tbr = L::sub(L::mul(Br, xr1), L::mul(Bi, xi1));
+                R tbi = L::add(L::mul(Br, xi1), L::mul(Bi, xr1));
+                R tdr = L::sub(L::mul(Dr, xr1), L::mul(Di, xi1));
+                R tdi = L::add(L::mul(Dr, xi1), L::mul(Di, xr1));
+
+                R a1r = L::add(Ar, tbr), a1i = L::add(Ai, tbi);
+                R b1r = L::sub(Ar, tbr), b1i = L::sub(Ai, tbi);
+                R c1r = L::add(Cr, tdr), c1i = L::add(Ci, tdi);
+                R d1r = L::sub(Cr, tdr), d1i = L::sub(Ci, tdi);
+
+                R tcr = L::sub(L::mul(c1r, xr2), L::mul(c1i, xi2));
+                R tci = L::add(L::mul(c1r, xi2), L::mul(c1i, xr2));
+                R ur  = L::sub(L::mul(d1r, xr2), L::mul(d1i, xi2));
+                R ui  = L::add(L::mul(d1r, xi2), L::mul(d1i, xr2));
+                R tdr2 = L::sub(zero, L::mul(vs, ui));
+                R tdi2 = L::mul(vs, ur);
+
+                L::store(ar + j, L::add(a1r, tcr));
+                L::store(ai + j, L::add(a1i, tci));
+                L::store(cr + j, L::sub(a1r, tcr));
+                L::store(ci + j, L::sub(a1i, tci));
+                L::store(br + j, L::add(b1r, tdr2));
+                L::store(bi + j, L::add(b1i, tdi2));
+                L::store(dr + j, L::sub(b1r, tdr2));
+                L::store(di + j, L::sub(b1i, tdi2));
+            }
+        }
+    }
+#endif
+
+    static typename FFTLanes<T>::reg broadcast(T v)
+    {
+        T lanes[FFTLanes<T>::width];
+        for (int i = 0; i < FFTLanes<T>::width; i++)
+            lanes[i] = v;
+        return FFTLanes<T>::load(lanes);
+    }
+
+    int N;
+    int logN;
+    double sign;
+    std::vector<int> reversed;
+    std::vector<Pass> passes;
+    T *re;
+    T *im;
+};
+
+// -------------------- any N --------------------
+// Power-of-two N runs Radix4FFT directly. Other sizes use Bluestein:
+//   X[k] = w[k] * sum_n (x[n] w[n]) conj(w[k - n]),  w[n] = exp(s pi i n^2 / N)
+// which is a circular convolution of length M >= 2N - 1 done with two M-point
+// FFTs (the chirp's spectrum is computed once per plan).
+template <typename T>
+class BuiltinFFT
+{
+public:
+    BuiltinFFT(int N, int direction)
+        : N(N), M(0), direct(NULL), forwardM(NULL), inverseM(NULL)
+    {
+        if ((N & (N - 1)) == 0)
+        {
+            direct = new Radix4FFT<T>(N, direction);
+            return;
+        }
+
+        M = 1;
+        while (M < 2 * N - 1)
+            M *= 2;
+        forwardM = new Radix4FFT<T>(M, -1);
+        inverseM = new Radix4FFT<T>(M, 1);
+
+        double sign = (direction < 0) ? -1.0 : 1.0;
+        chirpRe.resize(N);
+        chirpIm.resize(N);
+        for (int n = 0; n < N; n++)
+        {
+            // n^2 mod 2N keeps the angle small, so large N doesn't lose precision
+            long long n2 = (long long)n * n % (2LL * N);
+            double a = sign * M_PI * double(n2) / N;
+            chirpRe[n] = T(std::cos(a));
+            chirpIm[n] = T(std::sin(a));
+        }
+
+        filterRe.assign(M, T(0));
+        filterIm.assign(M, T(0));
+        for (int n = 0; n < N; n++)
+        {
+            filterRe[n] = chirpRe[n];
+            filterIm[n] = -chirpIm[n];
+            if (n > 0)
+            {
+                filterRe[M - n] = chirpRe[n];
+                filterIm[M - n] = -chirpIm[n];
+            }
+        }
+        forwardM->executeSplit(filterRe.data(), filterIm.data());
+
+        // fold the 1/M of the inverse transform into the filter
+        T scale = T(1.0 / M);
+        for (int i = 0; i < M; i++)
+        {
+            filterRe[i] *= scale;
+            filterIm[i] *= scale;
+        }
+
+        workRe.resize(M);
+        workIm.resize(M);
+    }
+
+    ~BuiltinFFT()
+    {
+        delete direct;
+        delete forwardM;
+        delete inverseM;
+    }
+
+    bool bluestein() const
+    {
+        return direct == NULL;
+    }
+
+    void execute(const T (*in)[2], T (*out)[2])
+    {
+        if (direct)
+        {
+            direct->execute(in, out);
+            return;
+        }
+
+        for (int n = 0; n < N; n++)
+        {
+            workRe[n] = in[n][0] * chirpRe[n] - in[n][1] * chirpIm[n];
+            workIm[n] = in[n][0] * chirpIm[n] + in[n][1] * chirpRe[n];
+        }
+        for (int n = N; n < M; n++)
+        {
+            workRe[n] = T(0);
+            workIm[n] = T(0);
+        }
+
+        forwardM->executeSplit(workRe.data(), workIm.data());
+        for (int i = 0; i < M; i++)
+        {
+            T r = workRe[i] * filterRe[i] - workIm[i] * filterIm[i];
+            T m = workRe[i] * filterIm[i] + workIm[i] * filterRe[i];
+            workRe[i] = r;
+            workIm[i] = m;
+        }
+        inverseM->executeSplit(workRe.data(), workIm.data());
+
+        for (int k = 0; k < N; k++)
+        {
+            out[k][0] = workRe[k] * chirpRe[k] - workIm[k] * chirpIm[k];
+            out[k][1] = workRe[k] * chirpIm[k] + workIm[k] * chirpRe[k];
+        }
+    }
+
+private:
+    BuiltinFFT(const BuiltinFFT&) = delete;
+    BuiltinFFT& operator=(const BuiltinFFT&) = delete;
+
+    int N, M;
+    Radix4FFT<T> *direct;
+    Radix4FFT<T> *forwardM;
+    Radix4FFT<T> *inverseM;
+    std::vector<T> chirpRe, chirpIm;
+    std::vector<T> filterRe, filterIm;
+    std::vector<T> workRe, workIm;
+};
+
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef COEFFICIENT_SELECT_H
+#define COEFFICIENT_SELECT_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// Picks which FFT bins become circles. Dropping a bin removes exactly its
+// energy from the traced path (Parseval: sum |x|^2 = 1/N sum |X_k|^2), so the
+// reconstruction error of a selection is known without reconstructing:
+//   error = sqrt(dropped energy / total energy)
+// relative to the path's L2 norm.
+struct CoefficientSelection
+{
+    std::vector<int> bins;      // FFT indices, DC-outward circle order
+    double error;               // relative L2 error of the path drawn by these bins
+};
+
+// Position of FFT bin k in the mapIndex order (DC, +1, -1, +2, -2, ...)
+inline int orderIndex(int k, int N)
+{
+    if (k == 0)
+        return 0;
+    if (k <= N / 2)
+        return 2 * k - 1;
+    return 2 * (N - k);
+}
+
+// |X_k|^2 for all N bins. A hermitian (r2c) spectrum only stores N/2+1 bins,
+// the mirrored ones have the same magnitude.
+template <typename T>
+std::vector<double> bin_energies(const T (*spectrum)[2], int N, bool hermitian)
+{
+    std::vector<double> energy(N);
+    for (int k = 0; k < N; k++)
+    {
+        int j = (hermitian && k > N / 2) ? N - k : k;
+        double re = spectrum[j][0];
+        double im = spectrum[j][1];
+        energy[k] = re * re + im * im;
+    }
+    return energy;
+}
+
+inline void finish_selection(CoefficientSelection& selection, std::vector<int>& order, int count,
+                             const std::vector<double>& energy, double total)
+{
+    double kept = 0;
+    for (int i = 0; i < count; i++)
+        kept += energy[order[i]];
+
+    int N = (int)energy.size();
+    selection.bins.assign(order.begin(), order.begin() + count);
+    std::sort(selection.bins.begin(), selection.bins.end(), [N](int a, int b) {
+        return orderIndex(a, N) < orderIndex(b, N);
+    });
+
+    double dropped = std::max(0.0, total - kept);
+    selection.error = total > 0 ? std::sqrt(dropped / total) : 0.0;
+}
+
+// The K largest bins. nth_element partitions in O(N), only the K kept bins
+// are sorted (into circle order).
+template <typename T>
+CoefficientSelection select_top_k(const T (*spectrum)[2], int N, int K, bool hermitian = false)
+{
+    std::vector<double> energy = bin_energies(spectrum, N, hermitian);
+    double total = 0;
+    for (double e : energy)
+        total += e;
+
+    std::vector<int> order(N);
+    for (int k = 0; k < N; k++)
+        order[k] = k;
+
+    K = std::max(0, std::min(K, N));
+    auto larger = [&](int a, int b) { return energy[a] > energy[b]; };
+    if (K < N)
+        std::nth_element(order.begin(), order.begin() + K, order.end(), larger);
+
+    CoefficientSelection selection;
+    finish_selection(selection, order, K, energy, total);
+    return selection;
+}
+
+// The fewest bins whose relative L2 error is within budget. Quickselect on the
+// running energy: each round partitions the undecided range around its middle
+// and keeps the half that must hold the cut, so the whole search is O(N).
+template <typename T>
+CoefficientSelection select_error_budget(const T (*spectrum)[2], int N, double budget, bool hermitian = false)
+{
+    std::vector<double> energy = bin_energies(spectrum, N, hermitian);
+    double total = 0;
+    for (double e : energy)
+        total += e;
+
+    std::vector<int> order(N);
+    for (int k = 0; k < N; k++)
+        order[k] = k;
+
+    budget = std::max(0.0, budget);
+    double target = total * (1.0 - budget * budget);
+    auto larger = [&](int a, int b) { return energy[a] > energy[b]; };
+
+    // invariant: order[0, lo) are the lo largest bins and fall short of the
+    // target, the hi largest reach it. The answer is hi once they meet.
+    int lo = 0, hi = N;
+    double keptLo = 0;
+    if (target <= 0)
+        hi = 0;
+    while (hi - lo > 1)
+    {
+        int mid = lo + (hi - lo) / 2;
+        std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi, larger);
+
+        double e = 0;
+        for (int i = lo; i < mid; i++)
+            e += energy[order[i]];
+
+        if (keptLo + e >= target)
+            hi = mid;
+        else
+        {
+            lo = mid;
+            keptLo += e;
+        }
+    }
+
+    CoefficientSelection selection;
+    finish_selection(selection, order, hi, energy, total);
+    return selection;
+}
+
+
+#endif
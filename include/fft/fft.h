@@ -0,0 +1,221 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <fftw/fftw3.h>
+#include <fft/fftw_traits.h>
+#include <fft/plan_cache.h>
+#include <fft/threaded_fft.h>
+#include <fft/builtin_fft.h>
+
+#include <map>
+#include <vector>
+
+
+// Entry point for every transform in the project. The backend can be switched
+// at runtime; building with -DFFT_NO_FFTW leaves only the builtin one, so
+// nothing references libfftw3 and it doesn't need to be linked. The fftw3.h
+// header is still used for the fftw_complex layout and the FFTW_FORWARD /
+// FFTW_BACKWARD constants.
+enum FFTBackend
+{
+    FFT_BACKEND_FFTW,
+    FFT_BACKEND_BUILTIN
+};
+
+inline FFTBackend& fft_backend()
+{
+#ifdef FFT_NO_FFTW
+    static FFTBackend backend = FFT_BACKEND_BUILTIN;
+#else
+    static FFTBackend backend = FFT_BACKEND_FFTW;
+#endif
+    return backend;
+}
+
+// Builtin plans are cached like the FFTW ones. They own scratch memory, so
+// (unlike FFTW plans) one plan must not run on two threads at once.
+template <typename T>
+BuiltinFFT<T>& builtin_plan(int N, int direction)
+{
+    static std::map<PlanKey, BuiltinFFT<T>*> plans;
+
+    PlanKey key;
+    key.N = N;
+    key.direction = direction;
+    key.precision = FFTW<T>::precision;
+    key.inPlace = false;
+    key.aligned = false;
+    key.real = false;
+    key.threads = 1;
+    key.howmany = 1;
+
+    BuiltinFFT<T> *&plan = plans[key];
+    if (!plan)
+        plan = new BuiltinFFT<T>(N, direction);
+    return *plan;
+}
+
+template <typename T>
+void fft_execute(int N, int direction, T (*in)[2], T (*out)[2])
+{
+#ifndef FFT_NO_FFTW
+    if (fft_backend() == FFT_BACKEND_FFTW)
+    {
+        fft_execute_fftw(N, direction, in, out);
+        return;
+    }
+#endif
+    builtin_plan<T>(N, direction).execute(in, out);
+}
+
+// N reals -> N/2+1 coefficients
+template <typename T>
+void fft_execute_r2c(int N, T *in, T (*out)[2])
+{
+#ifndef FFT_NO_FFTW
+    if (fft_backend() == FFT_BACKEND_FFTW)
+    {
+        typename FFTW<T>::plan p = PlanCacheT<T>::instance().getReal(N, FFTW_FORWARD, in, out);
+        FFTW<T>::execute_dft_r2c(p, in, out);
+        return;
+    }
+#endif
+    // the builtin engine has no real kernel, run it as a complex transform
+    static thread_local std::vector<T> scratch;
+    scratch.resize(2 * (size_t)N);
+    T (*full)[2] = (T (*)[2])scratch.data();
+    for (int i = 0; i < N; i++)
+    {
+        full[i][0] = in[i];
+        full[i][1] = T(0);
+    }
+    builtin_plan<T>(N, FFTW_FORWARD).execute(full, full);
+    for (int k = 0; k <= N / 2; k++)
+    {
+        out[k][0] = full[k][0];
+        out[k][1] = full[k][1];
+    }
+}
+
+// N/2+1 coefficients -> N reals, unnormalized. May overwrite in.
+template <typename T>
+void fft_execute_c2r(int N, T (*in)[2], T *out)
+{
+#ifndef FFT_NO_FFTW
+    if (fft_backend() == FFT_BACKEND_FFTW)
+    {
+        typename FFTW<T>::plan p = PlanCacheT<T>::instance().getReal(N, FFTW_BACKWARD, out, in);
+        FFTW<T>::execute_dft_c2r(p, in, out);
+        return;
+    }
+#endif
+    static thread_local std::vector<T> scratch;
+    scratch.resize(2 * (size_t)N);
+    T (*full)[2] = (T (*)[2])scratch.data();
+    for (int k = 0; k < N; k++)
+    {
+        if (k <= N / 2)
+        {
+            full[k][0] = in[k][0];
+            full[k][1] = in[k][1];
+        }
+        else
+        {
+            full[k][0] = in[N - k][0];
+            full[k][1] = -in[N - k][1];
+        }
+    }
+    builtin_plan<T>(N, FFTW_BACKWARD).execute(full, full);
+    for (int i = 0; i < N; i++)
+        out[i] = full[i][0];
+}
+
+// A forward real transform resolved once up front. fft_execute_r2c looks its
+// plan up in the caches on every call, which is only safe on the main thread;
+// this owns everything it runs with, so a worker thread can execute it with
+// no lookups and no allocation. The FFTW plan is made for the given buffers'
+// alignment, execute must be handed buffers aligned the same way.
+template <typename T>
+class RealFFTPlan
+{
+public:
+    RealFFTPlan(int N, T *in, T (*out)[2])
+        : N(N), builtin(NULL)
+    {
+#ifndef FFT_NO_FFTW
+        if (fft_backend() == FFT_BACKEND_FFTW)
+        {
+            plan = PlanCacheT<T>::instance().getReal(N, FFTW_FORWARD, in, out);
+            return;
+        }
+#endif
+        (void)in;
+        (void)out;
+        builtin = new BuiltinFFT<T>(N, FFTW_FORWARD);
+        scratch.resize(2 * (size_t)N);
+    }
+
+    ~RealFFTPlan()
+    {
+        delete builtin;
+    }
+
+    void execute(T *in, T (*out)[2])
+    {
+#ifndef FFT_NO_FFTW
+        if (!builtin)
+        {
+            FFTW<T>::execute_dft_r2c(plan, in, out);
+            return;
+        }
+#endif
+        T (*full)[2] = (T (*)[2])scratch.data();
+        for (int i = 0; i < N; i++)
+        {
+            full[i][0] = in[i];
+            full[i][1] = T(0);
+        }
+        builtin->execute(full, full);
+        for (int k = 0; k <= N / 2; k++)
+        {
+            out[k][0] = full[k][0];
+            out[k][1] = full[k][1];
+        }
+    }
+
+private:
+    RealFFTPlan(const RealFFTPlan&) = delete;
+    RealFFTPlan& operator=(const RealFFTPlan&) = delete;
+
+    int N;
+#ifndef FFT_NO_FFTW
+    typename FFTW<T>::plan plan;
+#endif
+    BuiltinFFT<T> *builtin;
+    std::vector<T> scratch;
+};
+
+template <typename T>
+bool fft_load_wisdom(const char *path)
+{
+#ifndef FFT_NO_FFTW
+    return PlanCacheT<T>::instance().loadWisdom(path);
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+template <typename T>
+bool fft_save_wisdom(const char *path)
+{
+#ifndef FFT_NO_FFTW
+    return PlanCacheT<T>::instance().saveWisdom(path);
+#else
+    (void)path;
+    return true;
+#endif
+}
+
+
+#endif
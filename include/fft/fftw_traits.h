@@ -0,0 +1,120 @@
+#ifndef FFTW_TRAITS_H
+#define FFTW_TRAITS_H
+
+#include <fftw/fftw3.h>
+
+#include <stddef.h>
+
+#ifdef FFT_NO_FFTW
+#include <fft/builtin_fft.h>
+#endif
+
+
+// Which precision a cached plan was made for (fftw_* vs fftwf_*)
+enum FFTPrecision
+{
+    FFT_DOUBLE = 0,
+    FFT_FLOAT  = 1
+};
+
+// Maps a scalar type onto the matching FFTW API so the wrappers can be written
+// once. FFTW<double> is fftw_* (libfftw3), FFTW<float> is fftwf_* (libfftw3f).
+template <typename T>
+struct FFTW;
+
+template <>
+struct FFTW<double>
+{
+    typedef fftw_complex complex;
+    typedef fftw_plan plan;
+    static const int precision = FFT_DOUBLE;
+
+#ifdef FFT_NO_FFTW
+    static void *malloc(size_t n) { return fft_aligned_malloc(n); }
+    static void free(void *p) { fft_aligned_free(p); }
+#else
+    static void *malloc(size_t n) { return fftw_malloc(n); }
+    static void free(void *p) { fftw_free(p); }
+#endif
+    static int alignment_of(double *p) { return fftw_alignment_of(p); }
+
+    static plan plan_dft_1d(int n, complex *in, complex *out, int sign, unsigned flags)
+    {
+        return fftw_plan_dft_1d(n, in, out, sign, flags);
+    }
+    static plan plan_dft_r2c_1d(int n, double *in, complex *out, unsigned flags)
+    {
+        return fftw_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static plan plan_dft_c2r_1d(int n, complex *in, double *out, unsigned flags)
+    {
+        return fftw_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    static plan plan_many_dft(int rank, const int *n, int howmany,
+                              complex *in, const int *inembed, int istride, int idist,
+                              complex *out, const int *onembed, int ostride, int odist,
+                              int sign, unsigned flags)
+    {
+        return fftw_plan_many_dft(rank, n, howmany, in, inembed, istride, idist,
+                                  out, onembed, ostride, odist, sign, flags);
+    }
+
+    static void execute_dft(plan p, complex *in, complex *out) { fftw_execute_dft(p, in, out); }
+    static void execute_dft_r2c(plan p, double *in, complex *out) { fftw_execute_dft_r2c(p, in, out); }
+    static void execute_dft_c2r(plan p, complex *in, double *out) { fftw_execute_dft_c2r(p, in, out); }
+    static void destroy_plan(plan p) { fftw_destroy_plan(p); }
+
+    static int import_wisdom_from_filename(const char *path) { return fftw_import_wisdom_from_filename(path); }
+    static int export_wisdom_to_filename(const char *path) { return fftw_export_wisdom_to_filename(path); }
+    static void forget_wisdom() { fftw_forget_wisdom(); }
+};
+
+template <>
+struct FFTW<float>
+{
+    typedef fftwf_complex complex;
+    typedef fftwf_plan plan;
+    static const int precision = FFT_FLOAT;
+
+#ifdef FFT_NO_FFTW
+    static void *malloc(size_t n) { return fft_aligned_malloc(n); }
+    static void free(void *p) { fft_aligned_free(p); }
+#else
+    static void *malloc(size_t n) { return fftwf_malloc(n); }
+    static void free(void *p) { fftwf_free(p); }
+#endif
+    static int alignment_of(float *p) { return fftwf_alignment_of(p); }
+
+    static plan plan_dft_1d(int n, complex *in, complex *out, int sign, unsigned flags)
+    {
+        return fftwf_plan_dft_1d(n, in, out, sign, flags);
+    }
+    static plan plan_dft_r2c_1d(int n, float *in, complex *out, unsigned flags)
+    {
+        return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static plan plan_dft_c2r_1d(int n, complex *in, float *out, unsigned flags)
+    {
+        return fftwf_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    static plan plan_many_dft(int rank, const int *n, int howmany,
+                              complex *in, const int *inembed, int istride, int idist,
+                              complex *out, const int *onembed, int ostride, int odist,
+                              int sign, unsigned flags)
+    {
+        return fftwf_plan_many_dft(rank, n, howmany, in, inembed, istride, idist,
+                                   out, onembed, ostride, odist, sign, flags);
+    }
+
+    static void execute_dft(plan p, complex *in, complex *out) { fftwf_execute_dft(p, in, out); }
+    static void execute_dft_r2c(plan p, float *in, complex *out) { fftwf_execute_dft_r2c(p, in, out); }
+    static void execute_dft_c2r(plan p, complex *in, float *out) { fftwf_execute_dft_c2r(p, in, out); }
+    static void destroy_plan(plan p) { fftwf_destroy_plan(p); }
+
+    static int import_wisdom_from_filename(const char *path) { return fftwf_import_wisdom_from_filename(path); }
+    static int export_wisdom_to_filename(const char *path) { return fftwf_export_wisdom_to_filename(path); }
+    static void forget_wisdom() { fftwf_forget_wisdom(); }
+};
+
+
+#endif
@@ -0,0 +1,245 @@
+#ifndef PLAN_CACHE_H
+#define PLAN_CACHE_H
+
+#include <fftw/fftw3.h>
+#include <fft/fftw_traits.h>
+
+#include <map>
+#include <tuple>
+#include <iostream>
+
+
+struct PlanKey
+{
+    int N;
+    int direction;
+    int precision;
+    bool inPlace;
+    bool aligned;
+    bool real;      // r2c (forward) / c2r (backward) instead of c2c
+    int threads;
+    int howmany;    // batch size for plan_many plans, 1 otherwise
+
+    bool operator<(const PlanKey& o) const
+    {
+        return std::tie(N, direction, precision, inPlace, aligned, real, threads, howmany) <
+               std::tie(o.N, o.direction, o.precision, o.inPlace, o.aligned, o.real, o.threads, o.howmany);
+    }
+};
+
+// Keeps every plan alive for the whole process so repeated transforms of the
+// same shape only pay for planning once. Plans are made on scratch buffers and
+// run on the caller's arrays through fftw_execute_dft, which is why the key
+// also carries in-place-ness and alignment (the new-array execute rules).
+// One cache per precision, PlanCache (double) and PlanCacheF (float).
+// Like the FFTW planner itself this is not thread safe: look plans up on the
+// main thread and hand the plan to workers (executing a plan is thread safe).
+template <typename T>
+class PlanCacheT
+{
+public:
+    typedef FFTW<T> api;
+    typedef typename api::complex complex_t;
+    typedef typename api::plan plan_t;
+
+    static PlanCacheT& instance()
+    {
+        static PlanCacheT cache;
+        return cache;
+    }
+
+    ~PlanCacheT()
+    {
+        clear();
+    }
+
+    // FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT ... used for plans made after this call
+    void setFlags(unsigned f)
+    {
+        flags = f;
+    }
+
+    unsigned getFlags() const
+    {
+        return flags;
+    }
+
+    plan_t get(int N, int direction, complex_t *in, complex_t *out)
+    {
+        PlanKey key;
+        key.N = N;
+        key.direction = direction;
+        key.precision = api::precision;
+        key.inPlace = (in == out);
+        key.aligned = api::alignment_of((T*)in) == 0 &&
+                      api::alignment_of((T*)out) == 0;
+        key.real = false;
+        key.threads = 1;
+        key.howmany = 1;
+
+        auto it = plans.find(key);
+        if (it != plans.end())
+            return it->second;
+
+        // planning with MEASURE/PATIENT scribbles over the arrays, so never plan on the caller's data
+        complex_t *scratchIn  = (complex_t*) api::malloc(sizeof(complex_t) * N);
+        complex_t *scratchOut = key.inPlace ? scratchIn
+                                            : (complex_t*) api::malloc(sizeof(complex_t) * N);
+
+        unsigned planFlags = flags;
+        if (!key.aligned)
+            planFlags |= FFTW_UNALIGNED;
+
+        plan_t p = api::plan_dft_1d(N, scratchIn, scratchOut, direction, planFlags);
+
+        if (!key.inPlace)
+            api::free(scratchOut);
+        api::free(scratchIn);
+
+        if (!p)
+        {
+            std::cout << "ERROR::FFT::PLAN_CREATION_FAILED N=" << N << std::endl;
+            return NULL;
+        }
+
+        plans[key] = p;
+        return p;
+    }
+
+    // howmany back to back transforms of length N (distance N between them)
+    // as one plan_many_dft, so a batch of shapes costs one plan and one execute.
+    plan_t getMany(int N, int howmany, int direction, complex_t *in, complex_t *out)
+    {
+        PlanKey key;
+        key.N = N;
+        key.direction = direction;
+        key.precision = api::precision;
+        key.inPlace = (in == out);
+        key.aligned = api::alignment_of((T*)in) == 0 &&
+                      api::alignment_of((T*)out) == 0;
+        key.real = false;
+        key.threads = 1;
+        key.howmany = howmany;
+
+        auto it = plans.find(key);
+        if (it != plans.end())
+            return it->second;
+
+        size_t total = (size_t)N * howmany;
+        complex_t *scratchIn  = (complex_t*) api::malloc(sizeof(complex_t) * total);
+        complex_t *scratchOut = key.inPlace ? scratchIn
+                                            : (complex_t*) api::malloc(sizeof(complex_t) * total);
+
+        unsigned planFlags = flags;
+        if (!key.aligned)
+            planFlags |= FFTW_UNALIGNED;
+
+        plan_t p = api::plan_many_dft(1, &N, howmany,
+                                      scratchIn, NULL, 1, N,
+                                      scratchOut, NULL, 1, N,
+                                      direction, planFlags);
+
+        if (!key.inPlace)
+            api::free(scratchOut);
+        api::free(scratchIn);
+
+        if (!p)
+        {
+            std::cout << "ERROR::FFT::PLAN_CREATION_FAILED N=" << N << " howmany=" << howmany << std::endl;
+            return NULL;
+        }
+
+        plans[key] = p;
+        return p;
+    }
+
+    // Real-input transforms. FFTW_FORWARD is r2c (N reals -> N/2+1 complex),
+    // FFTW_BACKWARD is c2r (N/2+1 complex -> N reals). c2r overwrites its input.
+    plan_t getReal(int N, int direction, T *real, complex_t *complex)
+    {
+        PlanKey key;
+        key.N = N;
+        key.direction = direction;
+        key.precision = api::precision;
+        key.inPlace = ((void*)real == (void*)complex);
+        key.aligned = api::alignment_of(real) == 0 &&
+                      api::alignment_of((T*)complex) == 0;
+        key.real = true;
+        key.threads = 1;
+        key.howmany = 1;
+
+        auto it = plans.find(key);
+        if (it != plans.end())
+            return it->second;
+
+        // in-place real transforms need the padded 2*(N/2+1) real layout
+        int complexSize = N / 2 + 1;
+        complex_t *scratchComplex = (complex_t*) api::malloc(sizeof(complex_t) * complexSize);
+        T *scratchReal = key.inPlace ? (T*)scratchComplex
+                                     : (T*) api::malloc(sizeof(T) * N);
+
+        unsigned planFlags = flags;
+        if (!key.aligned)
+            planFlags |= FFTW_UNALIGNED;
+
+        plan_t p;
+        if (direction == FFTW_FORWARD)
+            p = api::plan_dft_r2c_1d(N, scratchReal, scratchComplex, planFlags);
+        else
+            p = api::plan_dft_c2r_1d(N, scratchComplex, scratchReal, planFlags);
+
+        if (!key.inPlace)
+            api::free(scratchReal);
+        api::free(scratchComplex);
+
+        if (!p)
+        {
+            std::cout << "ERROR::FFT::PLAN_CREATION_FAILED N=" << N << std::endl;
+            return NULL;
+        }
+
+        plans[key] = p;
+        return p;
+    }
+
+    size_t size() const
+    {
+        return plans.size();
+    }
+
+    void clear()
+    {
+        for (auto& kv : plans)
+            api::destroy_plan(kv.second);
+        plans.clear();
+    }
+
+    bool loadWisdom(const char* path)
+    {
+        return api::import_wisdom_from_filename(path) != 0;
+    }
+
+    bool saveWisdom(const char* path)
+    {
+        if (!api::export_wisdom_to_filename(path))
+        {
+            std::cout << "ERROR::FFT::WISDOM_NOT_SUCCESFULLY_WRITTEN " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    PlanCacheT() = default;
+    PlanCacheT(const PlanCacheT&) = delete;
+    PlanCacheT& operator=(const PlanCacheT&) = delete;
+
+    std::map<PlanKey, plan_t> plans;
+    unsigned flags = FFTW_MEASURE;
+};
+
+typedef PlanCacheT<double> PlanCache;
+typedef PlanCacheT<float>  PlanCacheF;
+
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef PRUNED_FFT_H
+#define PRUNED_FFT_H
+
+#include <fft/fft.h>
+#include <fft/batch_fft.h>
+
+#include <cmath>
+#include <vector>
+
+
+// Only the bins -K..K of an N-point transform, the first 2K+1 circles in
+// mapIndex order. Uses transform decomposition: with N = P * M, splitting the
+// input into the P interleaved rows x[p], x[P + p], x[2P + p], ... gives
+//   X_f = sum_p W_N^(p f) * Y_p[f mod M]
+// where Y_p is the M-point FFT of row p. That costs N log M for the row FFTs
+// plus (2K+1) * P for the sums, instead of N log N for every bin.
+//
+// The two ends of the split are the familiar ones: M = 1 is a plain DFT bank
+// over the samples (no FFT at all, best for a handful of bins) and M = N is a
+// full FFT (best once K is a sizeable part of N). pruned_split picks M from the
+// divisors of N by estimated cost, so the K/N ratio decides the method.
+
+// Relative costs per element: one FFT butterfly stage, the row transpose plus
+// batch overhead, and one multiply-add + twiddle rotation in the DFT sum.
+// Fitted to "./benchmark pruned"; the transpose is strided and dominates.
+const double PRUNED_COST_FFT = 0.25;
+const double PRUNED_COST_COPY = 2.0;
+const double PRUNED_COST_SUM = 1.0;
+
+inline double pruned_cost(int N, int K, int M)
+{
+    double P = double(N) / M;
+    double cost = double(2 * K + 1) * P * PRUNED_COST_SUM;
+    if (M > 1)
+        cost += double(N) * (std::log2(double(M)) * PRUNED_COST_FFT + (M < N ? PRUNED_COST_COPY : 0.0));
+    return cost;
+}
+
+// Row length M (a divisor of N) with the lowest estimated cost
+inline int pruned_split(int N, int K)
+{
+    int best = N;
+    double bestCost = pruned_cost(N, K, N);
+    for (int d = 1; (long long)d * d <= N; d++)
+    {
+        if (N % d != 0)
+            continue;
+        int pair[2] = {d, N / d};
+        for (int M : pair)
+        {
+            double cost = pruned_cost(N, K, M);
+            if (cost < bestCost)
+            {
+                best = M;
+                bestCost = cost;
+            }
+        }
+    }
+    return best;
+}
+
+// Twiddles come from a rotation recurrence, restarted from an exact
+// cos/sin every PRUNED_RESYNC rows so the rounding can't build up over a
+// long input.
+const int PRUNED_RESYNC = 256;
+
+// out[f] = sum_p W_N^(p f) * rows[p * M + (f mod M)] for f = -K..K
+template <typename T>
+void pruned_sum(int N, int K, int M, int direction, const T (*rows)[2], T (*out)[2])
+{
+    const int P = N / M;
+    const int F = 2 * K + 1;
+
+    std::vector<int> column(F);
+    std::vector<T> buffer(8 * (size_t)F, T(0));
+    T *accRe = buffer.data(), *accIm = accRe + F;
+    T *wRe = accIm + F, *wIm = wRe + F;
+    T *stepRe = wIm + F, *stepIm = stepRe + F;
+    T *xRe = stepIm + F, *xIm = xRe + F;
+    for (int j = 0; j < F; j++)
+    {
+        int f = j - K;
+        column[j] = ((f % M) + M) % M;
+        double a = direction * 2.0 * M_PI * f / N;
+        stepRe[j] = T(std::cos(a));
+        stepIm[j] = T(std::sin(a));
+    }
+
+    for (int p0 = 0; p0 < P; p0 += PRUNED_RESYNC)
+    {
+        for (int j = 0; j < F; j++)
+        {
+            long long f = j - K;
+            double a = direction * 2.0 * M_PI * double(f * p0 % N) / N;
+            wRe[j] = T(std::cos(a));
+            wIm[j] = T(std::sin(a));
+        }
+
+        int p1 = std::min(P, p0 + PRUNED_RESYNC);
+        for (int p = p0; p < p1; p++)
+        {
+            // gather first so the sum below runs over contiguous arrays and vectorizes
+            const T (*row)[2] = rows + (size_t)p * M;
+            if (M == 1)
+            {
+                for (int j = 0; j < F; j++)
+                {
+                    xRe[j] = row[0][0];
+                    xIm[j] = row[0][1];
+                }
+            }
+            else
+            {
+                for (int j = 0; j < F; j++)
+                {
+                    xRe[j] = row[column[j]][0];
+                    xIm[j] = row[column[j]][1];
+                }
+            }
+
+            for (int j = 0; j < F; j++)
+            {
+                accRe[j] += xRe[j] * wRe[j] - xIm[j] * wIm[j];
+                accIm[j] += xRe[j] * wIm[j] + xIm[j] * wRe[j];
+
+                T r = wRe[j] * stepRe[j] - wIm[j] * stepIm[j];
+                wIm[j] = wRe[j] * stepIm[j] + wIm[j] * stepRe[j];
+                wRe[j] = r;
+            }
+        }
+    }
+
+    for (int j = 0; j < F; j++)
+    {
+        int f = j - K;
+        int k = f < 0 ? N + f : f;
+        out[k][0] = accRe[j];
+        out[k][1] = accIm[j];
+    }
+}
+
+// Writes bins 0..K and N-K..N-1 of the N-point transform of in, the rest of
+// out is zeroed so it still reads as a full spectrum (Circle, getCoefficient).
+// M forces the row length, 0 lets pruned_split choose.
+template <typename T>
+void fft_execute_pruned(int N, int K, int direction, T (*in)[2], T (*out)[2], int M = 0)
+{
+    if (2 * K + 1 >= N)
+    {
+        fft_execute(N, direction, in, out);
+        return;
+    }
+    if (M <= 0 || N % M != 0)
+        M = pruned_split(N, K);
+
+    if (M == N)
+    {
+        fft_execute(N, direction, in, out);
+        for (int k = K + 1; k < N - K; k++)
+            out[k][0] = out[k][1] = T(0);
+        return;
+    }
+
+    for (int k = 0; k < N; k++)
+        out[k][0] = out[k][1] = T(0);
+
+    if (M == 1)
+    {
+        pruned_sum(N, K, 1, direction, in, out);
+        return;
+    }
+
+    // row p is x[p], x[P + p], ..., transformed all at once as a batch
+    const int P = N / M;
+    static thread_local std::vector<T> rowScratch, fftScratch;
+    rowScratch.resize(2 * (size_t)N);
+    fftScratch.resize(2 * (size_t)N);
+    T (*rows)[2] = (T (*)[2])rowScratch.data();
+    T (*spectra)[2] = (T (*)[2])fftScratch.data();
+
+    for (int m = 0; m < M; m++)
+    {
+        for (int p = 0; p < P; p++)
+        {
+            rows[(size_t)p * M + m][0] = in[(size_t)m * P + p][0];
+            rows[(size_t)p * M + m][1] = in[(size_t)m * P + p][1];
+        }
+    }
+
+    fft_batch_execute(P, M, direction, rows, spectra);
+    pruned_sum(N, K, M, direction, spectra, out);
+}
+
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef SLIDING_DFT_H
+#define SLIDING_DFT_H
+
+#include <fft/fft.h>
+
+#include <cmath>
+#include <vector>
+
+
+// Sliding DFT over the last N samples of a path. When one sample enters and
+// the oldest one leaves, every bin moves by
+//   X_k' = (X_k - x_oldest + x_new) * exp(+2 pi i k / N)
+// which is O(1) per tracked bin instead of an O(N log N) FFT per sample.
+//
+// Each update multiplies by a rounded twiddle, so the error slowly random
+// walks; every resyncInterval samples the bins are recomputed with a full
+// FFT of the history, which bounds the drift no matter how long it runs.
+//
+// spectrum() is always the full N-point array in FFT order, so it can go
+// straight into Circle::update. With a bin list only those bins are kept
+// current (O(K) per sample), the rest hold their last resync values.
+template <typename T>
+class SlidingDFT
+{
+public:
+    typedef typename FFTW<T>::complex complex_t;
+
+    SlidingDFT(int N, int resyncInterval = 4096)
+        : N(N), resyncInterval(resyncInterval)
+    {
+        std::vector<int> all(N);
+        for (int k = 0; k < N; k++)
+            all[k] = k;
+        init(all);
+    }
+
+    SlidingDFT(int N, const std::vector<int>& trackedBins, int resyncInterval = 4096)
+        : N(N), resyncInterval(resyncInterval)
+    {
+        init(trackedBins);
+    }
+
+    ~SlidingDFT()
+    {
+        FFTW<T>::free(history);
+        FFTW<T>::free(ordered);
+        FFTW<T>::free(bins);
+    }
+
+    // Starts over from N samples (oldest first)
+    void reset(const complex_t *samples)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            history[i][0] = samples[i][0];
+            history[i][1] = samples[i][1];
+        }
+        oldest = 0;
+        resync();
+    }
+
+    void push(T re, T im)
+    {
+        T dr = re - history[oldest][0];
+        T di = im - history[oldest][1];
+        history[oldest][0] = re;
+        history[oldest][1] = im;
+        oldest = (oldest + 1 == N) ? 0 : oldest + 1;
+
+        const int K = (int)tracked.size();
+        const int *k = tracked.data();
+        const T *wr = twiddleRe.data();
+        const T *wi = twiddleIm.data();
+        for (int j = 0; j < K; j++)
+        {
+            T *X = bins[k[j]];
+            T xr = X[0] + dr;
+            T xi = X[1] + di;
+            X[0] = xr * wr[j] - xi * wi[j];
+            X[1] = xr * wi[j] + xi * wr[j];
+        }
+
+        if (++sinceResync >= resyncInterval)
+            resync();
+    }
+
+    // Full FFT of the current window, also called automatically
+    void resync()
+    {
+        for (int i = 0; i < N; i++)
+        {
+            int j = (oldest + i) % N;
+            ordered[i][0] = history[j][0];
+            ordered[i][1] = history[j][1];
+        }
+        fft_execute(N, FFTW_FORWARD, ordered, bins);
+        sinceResync = 0;
+    }
+
+    const complex_t *spectrum() const
+    {
+        return bins;
+    }
+
+    int size() const
+    {
+        return N;
+    }
+
+private:
+    SlidingDFT(const SlidingDFT&) = delete;
+    SlidingDFT& operator=(const SlidingDFT&) = delete;
+
+    void init(const std::vector<int>& trackedBins)
+    {
+        history = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+        ordered = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+        bins    = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+        for (int i = 0; i < N; i++)
+        {
+            history[i][0] = history[i][1] = T(0);
+            bins[i][0] = bins[i][1] = T(0);
+        }
+
+        tracked = trackedBins;
+        twiddleRe.resize(tracked.size());
+        twiddleIm.resize(tracked.size());
+        for (size_t j = 0; j < tracked.size(); j++)
+        {
+            double a = 2.0 * M_PI * tracked[j] / N;
+            twiddleRe[j] = T(std::cos(a));
+            twiddleIm[j] = T(std::sin(a));
+        }
+    }
+
+    int N;
+    int resyncInterval;
+    int sinceResync = 0;
+    int oldest = 0;
+
+    complex_t *history;     // circular, history[oldest] is the sample that leaves next
+    complex_t *ordered;     // history unrolled for the resync FFT
+    complex_t *bins;
+
+    std::vector<int> tracked;
+    std::vector<T> twiddleRe, twiddleIm;
+};
+
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef THREADED_FFT_H
+#define THREADED_FFT_H
+
+#include <fftw/fftw3.h>
+#include <fft/plan_cache.h>
+#include <thread_pool/thread_pool.h>
+
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <vector>
+
+
+// How fft_execute splits big transforms over the thread pool
+struct FFTThreadConfig
+{
+    int threads = 1;
+    int serialCutoff = 1 << 16;     // anything smaller runs on one thread
+};
+
+inline FFTThreadConfig& fft_thread_config()
+{
+    static FFTThreadConfig config;
+    return config;
+}
+
+// Four-step FFT. N = N1 * N2 is viewed as an N2 x N1 matrix:
+//   1. N2 strided FFTs of length N1 (split over the pool in row chunks)
+//   2. twiddle by w_N^(n2 * k1)
+//   3. N1 strided FFTs of length N2 (split over the pool in column chunks)
+// Every step is a batch of independent fftw_plan_many_dft calls, so the
+// threads never share output and the plans are only executed, never made,
+// off the main thread.
+template <typename T>
+class ThreadedFFT
+{
+public:
+    typedef FFTW<T> api;
+    typedef typename api::complex complex_t;
+    typedef typename api::plan plan_t;
+
+    ThreadedFFT(int N, int direction, int chunks)
+        : N(N), chunks(chunks)
+    {
+        N1 = 1;
+        for (int d = (int)std::sqrt((double)N); d > 1; d--)
+        {
+            if (N % d == 0)
+            {
+                N1 = d;
+                break;
+            }
+        }
+        N2 = N / N1;
+
+        tmp = (complex_t*) api::malloc(sizeof(complex_t) * N);
+        twiddle = (complex_t*) api::malloc(sizeof(complex_t) * N);
+
+        double sign = (direction == FFTW_FORWARD) ? -1.0 : 1.0;
+        for (int n2 = 0; n2 < N2; n2++)
+        {
+            for (int k1 = 0; k1 < N1; k1++)
+            {
+                double a = sign * 2.0 * M_PI * double((long long)n2 * k1 % N) / N;
+                twiddle[n2 * N1 + k1][0] = std::cos(a);
+                twiddle[n2 * N1 + k1][1] = std::sin(a);
+            }
+        }
+
+        // plans are made on scratch memory, see PlanCache::get
+        complex_t *scratch = (complex_t*) api::malloc(sizeof(complex_t) * N);
+        unsigned flags = PlanCacheT<T>::instance().getFlags() | FFTW_UNALIGNED;
+
+        rowChunk = (N2 + chunks - 1) / chunks;
+        colChunk = (N1 + chunks - 1) / chunks;
+        for (int c = 0; c < chunks; c++)
+        {
+            int rows = chunkSize(c, rowChunk, N2);
+            if (rows > 0 && !rowPlans.count(rows))
+            {
+                // input x[N2 * n1 + n2] -> tmp[n2 * N1 + k1]
+                rowPlans[rows] = api::plan_many_dft(1, &N1, rows,
+                                                    scratch, NULL, N2, 1,
+                                                    tmp, NULL, 1, N1,
+                                                    direction, flags);
+            }
+            int cols = chunkSize(c, colChunk, N1);
+            if (cols > 0 && !colPlans.count(cols))
+            {
+                // tmp[n2 * N1 + k1] -> out[k1 + N1 * k2]
+                colPlans[cols] = api::plan_many_dft(1, &N2, cols,
+                                                    tmp, NULL, N1, 1,
+                                                    scratch, NULL, N1, 1,
+                                                    direction, flags);
+            }
+        }
+        api::free(scratch);
+    }
+
+    ~ThreadedFFT()
+    {
+        for (auto& kv : rowPlans)
+            api::destroy_plan(kv.second);
+        for (auto& kv : colPlans)
+            api::destroy_plan(kv.second);
+        api::free(tmp);
+        api::free(twiddle);
+    }
+
+    // false when N has no useful factorization (e.g. prime)
+    bool usable() const
+    {
+        return N1 > 1 && N2 > 1;
+    }
+
+    void execute(complex_t *in, complex_t *out, ThreadPool& pool)
+    {
+        pool.parallelFor(chunks, [&](int c) {
+            int rows = chunkSize(c, rowChunk, N2);
+            if (rows <= 0)
+                return;
+            int first = c * rowChunk;
+            api::execute_dft(rowPlans.find(rows)->second, in + first, tmp + first * N1);
+
+            for (int i = first * N1; i < (first + rows) * N1; i++)
+            {
+                T re = tmp[i][0] * twiddle[i][0] - tmp[i][1] * twiddle[i][1];
+                T im = tmp[i][0] * twiddle[i][1] + tmp[i][1] * twiddle[i][0];
+                tmp[i][0] = re;
+                tmp[i][1] = im;
+            }
+        });
+
+        pool.parallelFor(chunks, [&](int c) {
+            int cols = chunkSize(c, colChunk, N1);
+            if (cols <= 0)
+                return;
+            int first = c * colChunk;
+            api::execute_dft(colPlans.find(cols)->second, tmp + first, out + first);
+        });
+    }
+
+private:
+    ThreadedFFT(const ThreadedFFT&) = delete;
+    ThreadedFFT& operator=(const ThreadedFFT&) = delete;
+
+    static int chunkSize(int c, int chunk, int total)
+    {
+        int first = c * chunk;
+        int last = std::min(first + chunk, total);
+        return last - first;
+    }
+
+    int N, N1, N2;
+    int chunks;
+    int rowChunk, colChunk;
+    complex_t *tmp;
+    complex_t *twiddle;
+    std::map<int, plan_t> rowPlans;
+    std::map<int, plan_t> colPlans;
+};
+
+// FFTW side of fft_execute (fft/fft.h): serial cached plan below the cutoff,
+// four-step on the shared thread pool above it. Threaded plans live as long
+// as the process. T is deduced from the array type: fftw_complex runs fftw_*,
+// fftwf_complex fftwf_*.
+template <typename T>
+void fft_execute_fftw(int N, int direction, T (*in)[2], T (*out)[2])
+{
+    FFTThreadConfig& config = fft_thread_config();
+
+    if (config.threads > 1 && N >= config.serialCutoff && in != out)
+    {
+        static std::map<PlanKey, ThreadedFFT<T>*> threadedPlans;
+
+        PlanKey key;
+        key.N = N;
+        key.direction = direction;
+        key.precision = FFTW<T>::precision;
+        key.inPlace = false;
+        key.aligned = false;
+        key.real = false;
+        key.threads = config.threads;
+        key.howmany = 1;
+
+        ThreadedFFT<T> *&plan = threadedPlans[key];
+        if (!plan)
+            plan = new ThreadedFFT<T>(N, direction, config.threads);
+
+        if (plan->usable())
+        {
+            ThreadPool& pool = ThreadPool::instance();
+            if (pool.size() != config.threads)
+                pool.resize(config.threads);
+            plan->execute(in, out, pool);
+            return;
+        }
+    }
+
+    typename FFTW<T>::plan p = PlanCacheT<T>::instance().get(N, direction, in, out);
+    FFTW<T>::execute_dft(p, in, out);
+}
+
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef GL_EXT_H
+#define GL_EXT_H
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <string.h>
+
+
+// The bundled glad loader is generated for GL 4.1, the newest macOS has.
+// The GPU paths need a few later entry points; they are declared here the way
+// glad would declare them and loaded by gl_ext_load() once a context exists.
+// Each block is skipped when glad already provides that version, so a
+// regenerated loader makes this header a no-op.
+//
+// gl_ext_load() returns false when the context is too old for compute or the
+// driver is missing any of it, callers then stay on the 4.1 path. Buffer
+// storage (4.4 or ARB_buffer_storage) and multi-draw indirect (4.3) are
+// checked on their own with gl_ext_buffer_storage() and
+// gl_ext_multi_draw_indirect(), they are useful without the rest.
+
+#ifndef GL_VERSION_4_2
+#define GL_VERSION_4_2 1
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#define GL_ALL_BARRIER_BITS 0xFFFFFFFF
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+inline PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = NULL;
+#define glMemoryBarrier glad_glMemoryBarrier
+#define GL_EXT_LOAD_4_2 1
+#endif
+
+#ifndef GL_VERSION_4_3
+#define GL_VERSION_4_3 1
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_MAX_COMPUTE_WORK_GROUP_SIZE 0x91BF
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+inline PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = NULL;
+#define glDispatchCompute glad_glDispatchCompute
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTPROC)(GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride);
+inline PFNGLMULTIDRAWARRAYSINDIRECTPROC glad_glMultiDrawArraysIndirect = NULL;
+#define glMultiDrawArraysIndirect glad_glMultiDrawArraysIndirect
+#define GL_EXT_LOAD_4_3 1
+#endif
+
+#ifndef GL_VERSION_4_4
+#define GL_VERSION_4_4 1
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+inline PFNGLBUFFERSTORAGEPROC glad_glBufferStorage = NULL;
+#define glBufferStorage glad_glBufferStorage
+#define GL_EXT_LOAD_4_4 1
+#endif
+
+// whether the context lists an extension, e.g. "GL_ARB_buffer_storage"
+inline bool gl_ext_supported(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline bool gl_ext_buffer_storage()
+{
+    if (!glBufferStorage)
+        return false;
+    return GLVersion.major * 10 + GLVersion.minor >= 44 || gl_ext_supported("GL_ARB_buffer_storage");
+}
+
+// glMultiDrawArraysIndirect with baseInstance honoured (4.2 or
+// ARB_base_instance, before that the field has to be 0)
+inline bool gl_ext_multi_draw_indirect()
+{
+    if (!glMultiDrawArraysIndirect)
+        return false;
+    if (GLVersion.major * 10 + GLVersion.minor >= 43)
+        return true;
+    return gl_ext_supported("GL_ARB_multi_draw_indirect") && gl_ext_supported("GL_ARB_base_instance");
+}
+
+inline bool gl_ext_load(GLADloadproc load)
+{
+#ifdef GL_EXT_LOAD_4_2
+    glad_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+#endif
+#ifdef GL_EXT_LOAD_4_3
+    glad_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+    glad_glMultiDrawArraysIndirect = (PFNGLMULTIDRAWARRAYSINDIRECTPROC)load("glMultiDrawArraysIndirect");
+#endif
+#ifdef GL_EXT_LOAD_4_4
+    glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+#endif
+
+    if (GLVersion.major * 10 + GLVersion.minor < 43)
+        return false;
+    return glMemoryBarrier && glDispatchCompute;
+}
+
+
+#endif
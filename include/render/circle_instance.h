@@ -0,0 +1,85 @@
+#ifndef CIRCLE_INSTANCE_H
+#define CIRCLE_INSTANCE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <stddef.h>
+#include <string.h>
+
+
+// What shaders/shader.vert reads per circle, 12 bytes instead of the 28 of
+// Circle (ID, frequency and the constant z stay on the CPU).
+//
+// The centre stays float: half would put it off by up to half a pixel at
+// full HD. Radius and the current angle only ever appear in the shader as
+// radius * (cos, sin), so that vector is stored instead, as two halves. The
+// vertex shader needs no trig, and the relative error of 2^-11 only scales
+// and turns the circle by far less than a pixel.
+struct CircleInstance
+{
+    float x, y;
+    glm::uint16 vx, vy;         // radius * (cos, sin) of the current angle
+};
+
+static_assert(sizeof(CircleInstance) == 12, "CircleInstance must stay packed");
+
+// float to half, round to nearest even. Branch-light version of the usual
+// bit trick: glm::packHalf1x16 costs about five times as much, and the
+// packing runs once per circle per frame. Overflow goes to infinity, NaN
+// stays NaN.
+inline glm::uint16 circle_instance_half(float value)
+{
+    glm::uint32 f;
+    memcpy(&f, &value, sizeof(f));
+    glm::uint32 sign = f & 0x80000000u;
+    f ^= sign;
+
+    glm::uint16 h;
+    if (f >= 0x47800000u)                       // too big for half, or inf/NaN
+        h = f > 0x7f800000u ? 0x7e00 : 0x7c00;
+    else if (f < 0x38800000u)                   // half denormal or zero
+    {
+        // adding 0.5 lines the half denormal bits up with the float mantissa
+        float denormal;
+        memcpy(&denormal, &f, sizeof(f));
+        denormal += 0.5f;
+        memcpy(&f, &denormal, sizeof(f));
+        h = glm::uint16(f - 0x3f000000u);
+    }
+    else
+    {
+        glm::uint32 odd = (f >> 13) & 1;
+        f += 0xc8000fffu + odd;                 // rebias exponent, round
+        h = glm::uint16(f >> 13);
+    }
+    return glm::uint16(h | (sign >> 16));
+}
+
+inline CircleInstance pack_circle_instance(float x, float y, float radius, float cosine, float sine)
+{
+    CircleInstance instance;
+    instance.x = x;
+    instance.y = y;
+    instance.vx = circle_instance_half(radius * cosine);
+    instance.vy = circle_instance_half(radius * sine);
+    return instance;
+}
+
+// Points attributes 1 (centre) and 2 (radius vector) of the bound VAO at
+// instances starting at base in the bound GL_ARRAY_BUFFER
+inline void circle_instance_attributes(GLintptr base)
+{
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(CircleInstance),
+                          (void*)(base + offsetof(CircleInstance, x)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CircleInstance),
+                          (void*)(base + offsetof(CircleInstance, vx)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+}
+
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef CIRCLE_MESH_LOD_H
+#define CIRCLE_MESH_LOD_H
+
+#include <glad/glad.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+// The layout glDrawArraysIndirect and glMultiDrawArraysIndirect read
+struct DrawArraysIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+// Screen-size adaptive tessellation. The circle line strip (centre, then
+// segments + 1 points round the rim) comes in LEVELS versions from 8 to 256
+// segments. Each circle gets the coarsest one whose chords stay within
+// TOLERANCE pixels of the true circle: a chord of an n-gon falls
+// r (1 - cos(pi / n)) short of the rim. That is 8 segments up to 3 pixels
+// of radius, 64 up to 200, 128 up to 830.
+//
+// assign() counting-sorts the circles by level, so each level's instances
+// are contiguous and one indirect command per level draws them all. Radii
+// only change when the spectrum does, and the levels only when the pixel
+// size does as well, so most frames reuse the last sort and only the
+// commands are sent again.
+class CircleMeshLod
+{
+public:
+    static const int LEVELS = 6;
+    static constexpr float TOLERANCE = 0.25f;   // pixels
+
+    CircleMeshLod()
+    {
+        GLuint first = 0;
+        for (int l = 0; l < LEVELS; l++)
+        {
+            firsts[l] = first;
+            first += stripVertices(l);
+            limits[l] = TOLERANCE / float(1.0 - std::cos(M_PI / segments(l)));
+        }
+    }
+
+    static int segments(int level)
+    {
+        return 8 << level;
+    }
+
+    // vertices in level's line strip
+    static GLuint stripVertices(int level)
+    {
+        return GLuint(segments(level) + 2);
+    }
+
+    // every level's strip, one after the other, as xyz like setupCircleMesh
+    void vertices(std::vector<float>& out) const
+    {
+        out.clear();
+        for (int l = 0; l < LEVELS; l++)
+        {
+            out.push_back(0.0f);
+            out.push_back(0.0f);
+            out.push_back(0.0f);
+            int n = segments(l);
+            for (int i = 0; i <= n; i++)
+            {
+                double a = 2.0 * M_PI * i / n;
+                out.push_back(float(std::cos(a)));
+                out.push_back(float(std::sin(a)));
+                out.push_back(0.0f);
+            }
+        }
+    }
+
+    // Offset of the strips in the buffer vertices() fills, added to first
+    void setBase(GLuint vertex)
+    {
+        base = vertex;
+        assigned = (size_t)-1;
+    }
+
+    int level(float radiusPixels) const
+    {
+        for (int l = 0; l < LEVELS - 1; l++)
+            if (std::fabs(radiusPixels) <= limits[l])
+                return l;
+        return LEVELS - 1;
+    }
+
+    // C is anything with a radius (Circle), call again when the radii change
+    template <typename C>
+    void build(const std::vector<C>& circles)
+    {
+        radius.resize(circles.size());
+        for (size_t i = 0; i < circles.size(); i++)
+            radius[i] = circles[i].radius;
+        pixels = -1;
+    }
+
+    // Levels and slots for the first count circles plus, when extraRadius
+    // is not negative, one more instance after them (the LOD envelope).
+    // Afterwards circle i's instance belongs at slot(i) and commands()
+    // draws every level from those slots.
+    void assign(size_t count, float pixelsPerWorld, float extraRadius = -1.0f)
+    {
+        count = std::min(count, radius.size());
+        int extra = extraRadius >= 0 ? level(extraRadius * pixelsPerWorld) : -1;
+
+        if (pixelsPerWorld != pixels)
+        {
+            levels.resize(radius.size());
+            for (size_t i = 0; i < radius.size(); i++)
+                levels[i] = (uint8_t)level(radius[i] * pixelsPerWorld);
+            pixels = pixelsPerWorld;
+            assigned = (size_t)-1;
+        }
+
+        if (count != assigned || extra != extraLevel)
+        {
+            GLuint sizes[LEVELS] = {0};
+            for (size_t i = 0; i < count; i++)
+                sizes[levels[i]]++;
+            if (extra >= 0)
+                sizes[extra]++;
+
+            GLuint next[LEVELS];
+            GLuint start = 0;
+            for (int l = 0; l < LEVELS; l++)
+            {
+                next[l] = start;
+                command[l].count = stripVertices(l);
+                command[l].instanceCount = sizes[l];
+                command[l].first = base + firsts[l];
+                command[l].baseInstance = start;
+                start += sizes[l];
+            }
+
+            slots.resize(count + 1);
+            for (size_t i = 0; i < count; i++)
+                slots[i] = next[levels[i]]++;
+            slots[count] = extra >= 0 ? next[extra] : (uint32_t)count;
+
+            assigned = count;
+            extraLevel = extra;
+        }
+    }
+
+    uint32_t slot(size_t i) const
+    {
+        return slots[i];
+    }
+
+    const uint32_t *slotData() const
+    {
+        return slots.data();
+    }
+
+    // one per level, empty levels have instanceCount 0
+    const DrawArraysIndirectCommand *commands() const
+    {
+        return command;
+    }
+
+    // vertices the commands draw, for comparing with a single mesh
+    size_t vertexTotal() const
+    {
+        size_t total = 0;
+        for (int l = 0; l < LEVELS; l++)
+            total += size_t(command[l].count) * command[l].instanceCount;
+        return total;
+    }
+
+private:
+    GLuint firsts[LEVELS];
+    float limits[LEVELS];
+    GLuint base = 0;
+
+    std::vector<float> radius;
+    std::vector<uint8_t> levels;
+    std::vector<uint32_t> slots;
+    DrawArraysIndirectCommand command[LEVELS] = {};
+
+    float pixels = -1;
+    size_t assigned = (size_t)-1;
+    int extraLevel = -1;
+};
+
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef GPU_CULL_H
+#define GPU_CULL_H
+
+#include <glad/glad.h>
+#include <gl_ext/gl_ext.h>
+#include <shader/shader.h>
+#include <render/circle_mesh_lod.h>
+
+#include <glm/glm.hpp>
+
+
+// GPU culling of the frame's CircleInstances by shaders/circle_cull.comp.
+// One dispatch tests every instance's bounding disc against the view and a
+// minimum radius, compacts the indices of the survivors into visibleBuffer()
+// and counts them into the DrawArraysIndirectCommand in commandBuffer(). The
+// draw that follows reads both (shaders/shader_cull.vert,
+// glDrawArraysIndirect), so the CPU does the same small amount of work
+// whatever is on screen and never waits for the count. Needs GL 4.3, check
+// gl_ext_load() first.
+class GpuCull
+{
+public:
+    static const int GROUP = 256;               // must match circle_cull.comp
+
+    GpuCull() = default;
+
+    ~GpuCull()
+    {
+        // program.ID is only set once init() has run
+        if (buffers[0])
+        {
+            glDeleteBuffers(2, buffers);
+            glDeleteProgram(program.ID);
+        }
+    }
+
+    void init(const char *computeFile)
+    {
+        program.initCompute(computeFile);
+        glGenBuffers(2, buffers);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COMMAND]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawArraysIndirectCommand), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        offsetLoc = glGetUniformLocation(program.ID, "offset");
+        countLoc = glGetUniformLocation(program.ID, "count");
+        viewLoc = glGetUniformLocation(program.ID, "view");
+        minRadiusLoc = glGetUniformLocation(program.ID, "minRadius");
+    }
+
+    // Culls count instances starting at byte base of the instances buffer.
+    // view is the world rectangle (xmin, ymin, xmax, ymax), minRadius in
+    // world units, vertexCount the mesh each surviving instance is drawn with
+    void cull(GLuint instances, GLintptr base, unsigned count,
+              const glm::vec4& view, float minRadius, GLuint vertexCount)
+    {
+        offset = (GLuint)(base / sizeof(GLuint));
+
+        // the shader only adds to instanceCount
+        DrawArraysIndirectCommand command = {vertexCount, 0, 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COMMAND]);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+
+        if (count > allocated)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[VISIBLE]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * count, NULL, GL_DYNAMIC_COPY);
+            allocated = count;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        if (!count)
+            return;
+
+        program.use();
+        glUniform1ui(offsetLoc, offset);
+        glUniform1ui(countLoc, count);
+        glUniform4f(viewLoc, view.x, view.y, view.z, view.w);
+        glUniform1f(minRadiusLoc, minRadius);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instances);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[VISIBLE]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, buffers[COMMAND]);
+
+        glDispatchCompute((count + GROUP - 1) / GROUP, 1, 1);
+        // the draw reads the indices in a shader and the count as a command
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    // words from the start of the instance buffer to the culled frame
+    GLuint instanceOffset() const
+    {
+        return offset;
+    }
+
+    GLuint visibleBuffer() const
+    {
+        return buffers[VISIBLE];
+    }
+
+    GLuint commandBuffer() const
+    {
+        return buffers[COMMAND];
+    }
+
+    // Reads the last count back, which waits for the GPU: benchmarks only
+    unsigned visibleCount() const
+    {
+        DrawArraysIndirectCommand command = {0, 0, 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[COMMAND]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(command), &command);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return command.instanceCount;
+    }
+
+private:
+    GpuCull(const GpuCull&) = delete;
+    GpuCull& operator=(const GpuCull&) = delete;
+
+    enum { VISIBLE, COMMAND };
+
+    Shader program;
+    GLuint buffers[2] = {0, 0};
+    GLint offsetLoc = -1, countLoc = -1, viewLoc = -1, minRadiusLoc = -1;
+
+    GLuint offset = 0;
+    unsigned allocated = 0;
+};
+
+
+#endif
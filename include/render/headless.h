@@ -0,0 +1,338 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+#ifdef RENDER_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+
+// A GL context with no window, for render boxes without a display and for
+// CI: EGL on the surfaceless platform (Mesa, llvmpipe when there is no GPU,
+// e.g. LIBGL_ALWAYS_SOFTWARE=1) renders into a framebuffer object of its
+// own that stays bound like the default framebuffer would be. Everything
+// drawn through CircleRenderer works unchanged.
+//
+// Needs -DRENDER_HEADLESS and -lEGL. Without them init() only says so, so
+// builds without EGL (macOS) don't change. Adding -DRENDER_NO_GLFW builds
+// main.cpp without GLFW, for machines that only ever run headless.
+//
+// present() stands in for swapping buffers: it resolves MSAA, waits for the
+// frame and records how long it took since the last one, for report(). The
+// clock is real time, or steps by a fixed amount per frame (setFixedStep())
+// so exported frames are the same on every run.
+class HeadlessContext
+{
+public:
+    HeadlessContext() = default;
+
+    ~HeadlessContext()
+    {
+        release();
+    }
+
+    // A core context of at least glMajor.glMinor rendering into a
+    // width x height framebuffer, samples 0 for no MSAA
+    bool init(int width, int height, int glMajor, int glMinor, int samples)
+    {
+        release();
+#ifdef RENDER_HEADLESS
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        display = getPlatformDisplay
+            ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+            : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint eglMajor, eglMinor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+        {
+            std::cout << "ERROR::HEADLESS::NO_EGL_DISPLAY" << std::endl;
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR::HEADLESS::NO_OPENGL_API" << std::endl;
+            release();
+            return false;
+        }
+
+        // no surface is ever made, so any config (or none) will do
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "EGL_KHR_no_config_context"))
+        {
+            const EGLint wanted[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+            EGLint found = 0;
+            if (!eglChooseConfig(display, wanted, &config, 1, &found) || found < 1)
+            {
+                std::cout << "ERROR::HEADLESS::NO_CONFIG" << std::endl;
+                release();
+                return false;
+            }
+        }
+
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, glMajor,
+            EGL_CONTEXT_MINOR_VERSION, glMinor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, attributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "ERROR::HEADLESS::NO_CONTEXT GL " << glMajor << "." << glMinor << std::endl;
+            release();
+            return false;
+        }
+        if (!gladLoadGLLoader(procAddress()))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            release();
+            return false;
+        }
+
+        framebufferWidth = width;
+        framebufferHeight = height;
+        if (!createFramebuffers(samples))
+        {
+            std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            release();
+            return false;
+        }
+        glViewport(0, 0, width, height);
+
+        frames = 0;
+        frameTimes.clear();
+        start = last = std::chrono::steady_clock::now();
+        return true;
+#else
+        (void)width; (void)height; (void)glMajor; (void)glMinor; (void)samples;
+        std::cout << "ERROR::HEADLESS::NOT_BUILT rebuild with -DRENDER_HEADLESS and -lEGL" << std::endl;
+        return false;
+#endif
+    }
+
+    bool active() const
+    {
+#ifdef RENDER_HEADLESS
+        return context != EGL_NO_CONTEXT;
+#else
+        return false;
+#endif
+    }
+
+    // for gladLoadGLLoader and gl_ext_load
+    static GLADloadproc procAddress()
+    {
+#ifdef RENDER_HEADLESS
+        return (GLADloadproc)eglGetProcAddress;
+#else
+        return NULL;
+#endif
+    }
+
+    void framebufferSize(int& width, int& height) const
+    {
+        width = framebufferWidth;
+        height = framebufferHeight;
+    }
+
+    // seconds since init(), like glfwGetTime
+    double time() const
+    {
+        if (fixedStep > 0)
+            return frames * fixedStep;
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // time() advances by step per presented frame, 0 goes back to real time
+    void setFixedStep(double step)
+    {
+        fixedStep = step;
+    }
+
+    int frameCount() const
+    {
+        return frames;
+    }
+
+    // Ends the frame: resolves MSAA, waits for the GPU and records the time
+    // since the last present(). The drawing framebuffer is bound again after
+    void present()
+    {
+        if (!active())
+            return;
+        resolve();
+        glFinish();
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+
+        // the first frame also took the setup
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (frames > 0)
+            frameTimes.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+        last = now;
+        frames++;
+    }
+
+    // The last presented frame as rows of RGB, top row first
+    void readPixels(std::vector<unsigned char>& rgb) const
+    {
+        size_t row = size_t(framebufferWidth) * 3;
+        rgb.resize(row * framebufferHeight);
+        if (!active())
+            return;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer ? resolveFramebuffer : drawFramebuffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, framebufferWidth, framebufferHeight, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+
+        // GL reads bottom up
+        std::vector<unsigned char> swap(row);
+        for (int y = 0; y < framebufferHeight / 2; y++)
+        {
+            unsigned char *top = &rgb[y * row];
+            unsigned char *bottom = &rgb[(framebufferHeight - 1 - y) * row];
+            memcpy(swap.data(), top, row);
+            memcpy(top, bottom, row);
+            memcpy(bottom, swap.data(), row);
+        }
+    }
+
+    // The last presented frame as a binary PPM
+    bool writePPM(const char *path) const
+    {
+        std::vector<unsigned char> rgb;
+        readPixels(rgb);
+        FILE *file = fopen(path, "wb");
+        if (!file)
+        {
+            std::cout << "ERROR::HEADLESS::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        fprintf(file, "P6\n%d %d\n255\n", framebufferWidth, framebufferHeight);
+        bool ok = fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+        fclose(file);
+        return ok;
+    }
+
+    // Frame times so far but the first, ms: mean, median, 99th percentile
+    // and worst
+    void report() const
+    {
+        if (frameTimes.empty())
+            return;
+        std::vector<double> sorted(frameTimes);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (double t : sorted)
+            sum += t;
+        printf("headless: %d frames at %dx%d, ms per frame mean %.3f median %.3f p99 %.3f max %.3f\n",
+               (int)sorted.size(), framebufferWidth, framebufferHeight, sum / sorted.size(),
+               sorted[sorted.size() / 2], sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)],
+               sorted.back());
+    }
+
+    void release()
+    {
+#ifdef RENDER_HEADLESS
+        if (context != EGL_NO_CONTEXT)
+        {
+            if (drawFramebuffer)
+            {
+                glDeleteFramebuffers(1, &drawFramebuffer);
+                glDeleteRenderbuffers(2, drawRenderbuffers);
+            }
+            if (resolveFramebuffer)
+            {
+                glDeleteFramebuffers(1, &resolveFramebuffer);
+                glDeleteRenderbuffers(1, &resolveRenderbuffer);
+            }
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            context = EGL_NO_CONTEXT;
+        }
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglTerminate(display);
+            display = EGL_NO_DISPLAY;
+        }
+#endif
+        drawFramebuffer = resolveFramebuffer = 0;
+        drawRenderbuffers[0] = drawRenderbuffers[1] = resolveRenderbuffer = 0;
+    }
+
+private:
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // colour and depth to draw into, multisampled with a plain colour
+    // buffer to resolve into when samples > 0
+    bool createFramebuffers(int samples)
+    {
+        glGenFramebuffers(1, &drawFramebuffer);
+        glGenRenderbuffers(2, drawRenderbuffers);
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, drawRenderbuffers[0]);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, framebufferWidth, framebufferHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, drawRenderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, drawRenderbuffers[1]);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, framebufferWidth, framebufferHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, drawRenderbuffers[1]);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+        if (complete && samples > 0)
+        {
+            glGenFramebuffers(1, &resolveFramebuffer);
+            glGenRenderbuffers(1, &resolveRenderbuffer);
+            glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, resolveRenderbuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, framebufferWidth, framebufferHeight);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveRenderbuffer);
+            complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        }
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+        return complete;
+    }
+
+    void resolve()
+    {
+        if (!resolveFramebuffer)
+            return;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+        glBlitFramebuffer(0, 0, framebufferWidth, framebufferHeight,
+                          0, 0, framebufferWidth, framebufferHeight,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+#ifdef RENDER_HEADLESS
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+    GLuint drawFramebuffer = 0;
+    GLuint drawRenderbuffers[2] = {0, 0};       // colour, depth
+    GLuint resolveFramebuffer = 0;
+    GLuint resolveRenderbuffer = 0;
+    int framebufferWidth = 0;
+    int framebufferHeight = 0;
+
+    double fixedStep = 0;
+    int frames = 0;
+    std::vector<double> frameTimes;
+    std::chrono::steady_clock::time_point start, last;
+};
+
+
+#endif
@@ -0,0 +1,295 @@
+#ifndef INSTANCE_STREAM_H
+#define INSTANCE_STREAM_H
+
+#include <glad/glad.h>
+#include <gl_ext/gl_ext.h>
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+
+
+// Per-frame instance data upload. Every strategy has the same three calls:
+//   T *dst = stream.map(bytes);    write this frame's data to dst
+//   GLintptr at = stream.commit(); offset of that data in buffer()
+//   ...draw from buffer() at that offset...
+//   stream.fence();                after the last draw that reads it
+//
+//   orphan      glBufferData(NULL) then glBufferSubData from a CPU copy: the
+//               driver hands out fresh storage instead of waiting for the GPU
+//   subdata     glBufferSubData into one fixed buffer from a CPU copy, may
+//               stall when the GPU is still reading last frame's data
+//   map-ring    glMapBufferRange(UNSYNCHRONIZED) on consecutive ranges of a
+//               ring three frames long, orphaned when it wraps; the caller
+//               writes straight into driver memory
+//   persistent  buffer storage mapped once (PERSISTENT | COHERENT), three
+//               regions used in turn, each guarded by a fence so the CPU
+//               never overwrites a region the GPU hasn't finished with.
+//               Needs GL 4.4 or ARB_buffer_storage, see gl_ext_buffer_storage()
+//
+// Mapped memory is write-combined: write it in order and never read it back.
+
+enum UploadStrategy
+{
+    UPLOAD_ORPHAN,
+    UPLOAD_SUBDATA,
+    UPLOAD_MAP_RING,
+    UPLOAD_PERSISTENT
+};
+
+inline const char *upload_strategy_name(UploadStrategy strategy)
+{
+    switch (strategy)
+    {
+    case UPLOAD_ORPHAN:     return "orphan";
+    case UPLOAD_SUBDATA:    return "subdata";
+    case UPLOAD_MAP_RING:   return "map-ring";
+    case UPLOAD_PERSISTENT: return "persistent";
+    default:                return "unknown";
+    }
+}
+
+inline bool parse_upload_strategy(const char *name, UploadStrategy& strategy)
+{
+    const UploadStrategy all[] = {UPLOAD_ORPHAN, UPLOAD_SUBDATA, UPLOAD_MAP_RING, UPLOAD_PERSISTENT};
+    for (UploadStrategy s : all)
+    {
+        if (strcmp(name, upload_strategy_name(s)) == 0)
+        {
+            strategy = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+// the best one the context has
+inline UploadStrategy upload_strategy_default()
+{
+    return gl_ext_buffer_storage() ? UPLOAD_PERSISTENT : UPLOAD_MAP_RING;
+}
+
+class InstanceStream
+{
+public:
+    static const int REGIONS = 3;               // frames in flight
+    static const GLsizeiptr ALIGN = 256;        // region and ring offsets
+
+    InstanceStream() = default;
+
+    ~InstanceStream()
+    {
+        release();
+        if (vbo) glDeleteBuffers(1, &vbo);
+    }
+
+    // A buffer of the given strategy, persistent falls back to map-ring when
+    // the context has no buffer storage
+    void init(UploadStrategy s)
+    {
+        release();
+        if (s == UPLOAD_PERSISTENT && !gl_ext_buffer_storage())
+        {
+            std::cout << "ERROR::UPLOAD::NO_BUFFER_STORAGE falling back to map-ring" << std::endl;
+            s = UPLOAD_MAP_RING;
+        }
+        strategy = s;
+        // buffer storage is immutable, every init needs a new name
+        if (vbo) glDeleteBuffers(1, &vbo);
+        glGenBuffers(1, &vbo);
+    }
+
+    UploadStrategy current() const
+    {
+        return strategy;
+    }
+
+    GLuint buffer() const
+    {
+        return vbo;
+    }
+
+    // Where this frame's bytes go, valid until commit()
+    void *map(GLsizeiptr bytes)
+    {
+        size = bytes;
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+        switch (strategy)
+        {
+        case UPLOAD_ORPHAN:
+        case UPLOAD_SUBDATA:
+            staging.resize((size_t)bytes);
+            return staging.data();
+
+        case UPLOAD_MAP_RING:
+        {
+            GLsizeiptr region = aligned(bytes);
+            if (REGIONS * region > capacity)
+                allocate(REGIONS * region);
+            // wrapping orphans the ring, the GPU keeps reading the old storage
+            if (head + region > capacity)
+            {
+                glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+                head = 0;
+            }
+            offset = head;
+            head += region;
+            if (!bytes)
+                return staging.data();
+            return glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+
+        case UPLOAD_PERSISTENT:
+        default:
+        {
+            GLsizeiptr region = aligned(bytes);
+            if (REGIONS * region > capacity)
+                allocate(REGIONS * region);
+            // the map-ring fallback may have replaced this strategy
+            if (strategy == UPLOAD_MAP_RING)
+                return map(bytes);
+            offset = slot * (capacity / REGIONS);
+            wait(slot);
+            return mapped + offset;
+        }
+        }
+    }
+
+    // Finishes the upload, returns the data's offset in buffer()
+    GLintptr commit()
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+        switch (strategy)
+        {
+        case UPLOAD_ORPHAN:
+            if (size > capacity)
+                capacity = size;
+            glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, staging.data());
+            return 0;
+
+        case UPLOAD_SUBDATA:
+            if (size > capacity)
+                allocate(size);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, staging.data());
+            return 0;
+
+        case UPLOAD_MAP_RING:
+            if (size)
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            return offset;
+
+        case UPLOAD_PERSISTENT:
+        default:
+            // coherent: the writes are visible to commands issued from now on
+            return offset;
+        }
+    }
+
+    // Call after the draws that read this frame's data
+    void fence()
+    {
+        if (strategy != UPLOAD_PERSISTENT || !mapped)
+            return;
+        if (fences[slot])
+            glDeleteSync(fences[slot]);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot = (slot + 1) % REGIONS;
+    }
+
+private:
+    InstanceStream(const InstanceStream&) = delete;
+    InstanceStream& operator=(const InstanceStream&) = delete;
+
+    static GLsizeiptr aligned(GLsizeiptr bytes)
+    {
+        GLsizeiptr a = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        return a ? a : ALIGN;
+    }
+
+    void allocate(GLsizeiptr bytes)
+    {
+        // half as much again, so a slowly growing chain doesn't reallocate
+        // every frame; rings stay a whole number of aligned regions
+        if (strategy == UPLOAD_PERSISTENT || strategy == UPLOAD_MAP_RING)
+            bytes = REGIONS * aligned(bytes / REGIONS * 3 / 2);
+        else
+            bytes = aligned(bytes * 3 / 2);
+
+        if (strategy == UPLOAD_PERSISTENT)
+        {
+            // immutable storage can't be resized, start over with a new buffer
+            release();
+            glDeleteBuffers(1, &vbo);
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+            mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+            if (!mapped)
+            {
+                std::cout << "ERROR::UPLOAD::PERSISTENT_MAP_FAILED falling back to map-ring" << std::endl;
+                init(UPLOAD_MAP_RING);
+                glBindBuffer(GL_ARRAY_BUFFER, vbo);
+                glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            }
+        }
+        else
+            glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+
+        capacity = bytes;
+        head = 0;
+    }
+
+    void wait(int region)
+    {
+        if (!fences[region])
+            return;
+        // flush once so the fence can signal, then wait as long as it takes
+        GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fences[region], 0, 1000000000);
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+
+    void release()
+    {
+        for (int r = 0; r < REGIONS; r++)
+        {
+            if (fences[r])
+            {
+                glDeleteSync(fences[r]);
+                fences[r] = 0;
+            }
+        }
+        if (mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = NULL;
+        }
+        capacity = 0;
+        head = 0;
+        slot = 0;
+    }
+
+    UploadStrategy strategy = UPLOAD_ORPHAN;
+    GLuint vbo = 0;
+    GLsizeiptr capacity = 0;
+    GLsizeiptr size = 0;
+    GLintptr offset = 0;
+    GLintptr head = 0;
+
+    std::vector<char> staging;
+    char *mapped = NULL;
+    GLsync fences[REGIONS] = {0, 0, 0};
+    int slot = 0;           // persistent region this frame writes
+};
+
+
+#endif
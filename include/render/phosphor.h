@@ -0,0 +1,182 @@
+#ifndef PHOSPHOR_H
+#define PHOSPHOR_H
+
+#include <glad/glad.h>
+#include <shader/shader.h>
+
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+// Persistence like a phosphor screen: the image lives in an offscreen
+// buffer that is faded a little every frame and drawn onto the frame, so
+// only the newest geometry has to be drawn into it. A trail of any length
+// costs two full-screen passes (shaders/phosphor.*) and the two buffers,
+// not memory or vertices per point.
+//
+// The buffers ping-pong: begin() draws the last image, times the decay,
+// into the other one and leaves it bound for the new geometry, end()
+// switches back and adds it to the frame. They are half float so a slow
+// decay doesn't round away to nothing or stick at 8 bit steps, and can be a
+// fraction of the framebuffer's resolution (resize()'s scale): the passes
+// then cost that fraction squared and the image is filtered up.
+class Phosphor
+{
+public:
+    // what a decay pass takes off on top of the factor, so anything ends up
+    // at zero however close to 1 the factor is
+    static constexpr float CUTOFF = 1.0f / 4096.0f;
+
+    Phosphor() = default;
+
+    ~Phosphor()
+    {
+        release();
+        if (vao)
+        {
+            glDeleteVertexArrays(1, &vao);
+            glDeleteProgram(program.ID);
+        }
+    }
+
+    void init(const char *vsFile, const char *fsFile)
+    {
+        program.init(vsFile, fsFile);
+        imageLoc = glGetUniformLocation(program.ID, "image");
+        gainLoc = glGetUniformLocation(program.ID, "gain");
+        cutoffLoc = glGetUniformLocation(program.ID, "cutoff");
+        // the pass has no vertex buffer, core profile still wants a VAO
+        glGenVertexArrays(1, &vao);
+    }
+
+    // Buffers for a framebuffer of width x height, at scale (0, 1] of its
+    // resolution. Starts from black when the size changes
+    void resize(int framebufferWidth, int framebufferHeight, float scale)
+    {
+        scale = std::min(std::max(scale, 0.01f), 1.0f);
+        int w = std::max(1, (int)std::lround(framebufferWidth * scale));
+        int h = std::max(1, (int)std::lround(framebufferHeight * scale));
+        if (fbo[0] && w == width && h == height)
+            return;
+
+        release();
+        width = w;
+        height = h;
+
+        GLint previous = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+        glGenTextures(2, texture);
+        glGenFramebuffers(2, fbo);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture[i], 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::PHOSPHOR::FRAMEBUFFER_INCOMPLETE" << std::endl;
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, previous);
+        current = 0;
+    }
+
+    int bufferWidth() const
+    {
+        return width;
+    }
+
+    int bufferHeight() const
+    {
+        return height;
+    }
+
+    // GPU memory of both buffers
+    size_t bytes() const
+    {
+        return 2 * size_t(width) * size_t(height) * 4 * 2;
+    }
+
+    // The last image times decay into the other buffer, which stays bound
+    // with its viewport for the frame's new geometry until end()
+    void begin(float decay)
+    {
+        if (!fbo[0])
+            return;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        glGetIntegerv(GL_VIEWPORT, targetViewport);
+
+        int next = 1 - current;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo[next]);
+        glViewport(0, 0, width, height);
+        glDisable(GL_BLEND);
+        pass(texture[current], decay, CUTOFF);
+        current = next;
+    }
+
+    // Back to the framebuffer begin() found, with the image added on top
+    void end()
+    {
+        if (!fbo[0])
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(targetViewport[0], targetViewport[1], targetViewport[2], targetViewport[3]);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        pass(texture[current], 1.0f, 0.0f);
+        glDisable(GL_BLEND);
+    }
+
+private:
+    Phosphor(const Phosphor&) = delete;
+    Phosphor& operator=(const Phosphor&) = delete;
+
+    void pass(GLuint image, float gain, float cutoff)
+    {
+        program.use();
+        glUniform1i(imageLoc, 0);
+        glUniform1f(gainLoc, gain);
+        glUniform1f(cutoffLoc, cutoff);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, image);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void release()
+    {
+        if (fbo[0])
+        {
+            glDeleteFramebuffers(2, fbo);
+            glDeleteTextures(2, texture);
+            fbo[0] = fbo[1] = 0;
+            texture[0] = texture[1] = 0;
+        }
+    }
+
+    Shader program;
+    GLint imageLoc = -1, gainLoc = -1, cutoffLoc = -1;
+    GLuint vao = 0;
+
+    GLuint fbo[2] = {0, 0};
+    GLuint texture[2] = {0, 0};
+    int current = 0;                // buffer holding the image
+    int width = 0;
+    int height = 0;
+
+    GLint target = 0;
+    GLint targetViewport[4] = {0, 0, 0, 0};
+};
+
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef TRAIL_H
+#define TRAIL_H
+
+#include <glad/glad.h>
+#include <gl_ext/gl_ext.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+
+// One point of the trail: where the tip was and when, in the low 32 bits of
+// its tick (see phase_ticks), so the shader can fade it by age. Unsigned
+// differences stay right across the wrap every 18 hours.
+struct TrailVertex
+{
+    float x, y;
+    uint32_t tick;
+};
+
+// The path the tip traced, kept in a ring of capacity points on the GPU that
+// is allocated once: memory and per-frame cost don't grow with uptime.
+//
+// With buffer storage (gl_ext_buffer_storage) the ring is mapped once,
+// persistent and coherent, and append() writes straight into it; otherwise
+// the new points go up with glBufferSubData. The GPU may still be drawing
+// the last REGIONS - 1 frames, so append() first waits for the frame before
+// those, and the drawn window stops REGIONS * perFrame points short of the
+// whole ring: the points a frame overwrites are never ones a frame in flight
+// reads.
+//
+// The ring has one slot more than capacity holding a copy of slot 0, so the
+// window is at most two line strips that still join up where the ring wraps.
+class Trail
+{
+public:
+    static const int REGIONS = 3;               // frames in flight
+
+    Trail() = default;
+
+    ~Trail()
+    {
+        release();
+        if (vbo) glDeleteBuffers(1, &vbo);
+        if (vao) glDeleteVertexArrays(1, &vao);
+    }
+
+    // capacity points in all, at most perFrame of them appended per frame
+    void init(size_t capacity, size_t perFrame)
+    {
+        release();
+        ring = std::max<size_t>(capacity, REGIONS * perFrame + 2);
+        maxPerFrame = perFrame;
+        head = 0;
+        total = 0;
+
+        if (!vao)
+        {
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &vbo);
+        }
+        else
+        {
+            // buffer storage is immutable, a new size needs a new name
+            glDeleteBuffers(1, &vbo);
+            glGenBuffers(1, &vbo);
+        }
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        GLsizeiptr bytes = (GLsizeiptr)((ring + 1) * sizeof(TrailVertex));
+        if (gl_ext_buffer_storage())
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+            mapped = (TrailVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+            if (!mapped)
+                std::cout << "ERROR::TRAIL::PERSISTENT_MAP_FAILED falling back to glBufferSubData" << std::endl;
+        }
+        if (!mapped)
+            glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TrailVertex),
+                              (void*)offsetof(TrailVertex, x));
+        glEnableVertexAttribArray(0);
+        glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(TrailVertex),
+                               (void*)offsetof(TrailVertex, tick));
+        glEnableVertexAttribArray(1);
+    }
+
+    size_t perFrame() const
+    {
+        return maxPerFrame;
+    }
+
+    // Points drawn: everything appended, up to the safe window
+    size_t size() const
+    {
+        return std::min(total, ring - REGIONS * maxPerFrame);
+    }
+
+    void clear()
+    {
+        total = 0;
+    }
+
+    // This frame's points, oldest first; anything past perFrame() is dropped
+    void append(const TrailVertex *points, size_t count)
+    {
+        count = std::min(count, maxPerFrame);
+        if (!count || !vbo)
+            return;
+        wait(slot);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        while (count)
+        {
+            size_t run = std::min(count, ring - head);
+            write(head, points, run);
+            // slot 0's copy past the end joins the two strips
+            if (head == 0)
+                write(ring, points, 1);
+
+            points += run;
+            count -= run;
+            total += run;
+            head = (head + run) % ring;
+        }
+    }
+
+    // The window, or only its newest points, as line strips (or GL_POINTS),
+    // at most two draws. Needs a program that reads attributes 0 (vec2
+    // position) and 1 (uint tick) bound already
+    void draw(size_t newest = (size_t)-1, GLenum mode = GL_LINE_STRIP)
+    {
+        size_t n = std::min(size(), newest);
+        if (n < (mode == GL_POINTS ? 1u : 2u))
+            return;
+
+        glBindVertexArray(vao);
+        size_t start = (head + ring - n) % ring;
+        if (start < head)
+            glDrawArrays(mode, (GLint)start, (GLsizei)n);
+        else
+        {
+            // to the end, through the copy of slot 0 when the strip goes on
+            // from there
+            size_t join = (head > 0 && mode != GL_POINTS) ? 1 : 0;
+            glDrawArrays(mode, (GLint)start, (GLsizei)(ring - start + join));
+            if (head > 0)
+                glDrawArrays(mode, 0, (GLsizei)head);
+        }
+    }
+
+    // Call after the frame's draw
+    void fence()
+    {
+        if (!mapped)
+            return;
+        if (fences[slot])
+            glDeleteSync(fences[slot]);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot = (slot + 1) % REGIONS;
+    }
+
+private:
+    Trail(const Trail&) = delete;
+    Trail& operator=(const Trail&) = delete;
+
+    void write(size_t at, const TrailVertex *points, size_t count)
+    {
+        if (mapped)
+            memcpy(mapped + at, points, count * sizeof(TrailVertex));
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(at * sizeof(TrailVertex)),
+                            (GLsizeiptr)(count * sizeof(TrailVertex)), points);
+    }
+
+    void wait(int region)
+    {
+        if (!fences[region])
+            return;
+        GLenum status = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fences[region], 0, 1000000000);
+        glDeleteSync(fences[region]);
+        fences[region] = 0;
+    }
+
+    void release()
+    {
+        for (int r = 0; r < REGIONS; r++)
+        {
+            if (fences[r])
+            {
+                glDeleteSync(fences[r]);
+                fences[r] = 0;
+            }
+        }
+        if (mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = NULL;
+        }
+        slot = 0;
+    }
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    TrailVertex *mapped = NULL;
+    GLsync fences[REGIONS] = {0, 0, 0};
+    int slot = 0;
+
+    size_t ring = 0;            // slots, the buffer has one more
+    size_t maxPerFrame = 0;
+    size_t head = 0;            // next slot to write
+    size_t total = 0;           // points appended since clear()
+};
+
+
+#endif
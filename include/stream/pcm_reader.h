@@ -0,0 +1,264 @@
+#ifndef PCM_READER_H
+#define PCM_READER_H
+
+#include <stream/ring_buffer.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+
+// Reads a PCM stream on its own thread and pushes mono float samples into a
+// ring buffer. Accepts a WAV file (16 bit integer or 32 bit float, any
+// channel count, mixed down to mono) or, for "-", stdin. stdin may carry a WAV
+// header too; without one it is taken as raw signed 16 bit mono at the
+// configured sample rate (e.g. "arecord -t raw -f S16_LE" or
+// "ffmpeg -f s16le -ac 1 -").
+//
+// Files are paced to real time so the epicycles play along with the audio,
+// stdin is read as fast as it arrives.
+class PcmReader
+{
+public:
+    PcmReader(SpscRingBuffer<float>& ring, int defaultSampleRate = 44100)
+        : ring(ring), sampleRate(defaultSampleRate)
+    {
+    }
+
+    ~PcmReader()
+    {
+        stop();
+        if (file && file != stdin)
+            fclose(file);
+    }
+
+    bool open(const char *path)
+    {
+        if (strcmp(path, "-") == 0)
+        {
+            file = stdin;
+            realtime = false;
+        }
+        else
+        {
+            file = fopen(path, "rb");
+            realtime = true;
+        }
+
+        if (!file)
+        {
+            std::cout << "ERROR::PCM::FILE_NOT_SUCCESFULLY_OPENED " << path << std::endl;
+            return false;
+        }
+        return readHeader();
+    }
+
+    void start()
+    {
+        running = true;
+        worker = std::thread([this]() { readLoop(); });
+    }
+
+    void stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool finished() const
+    {
+        return done;
+    }
+
+    int getSampleRate() const
+    {
+        return sampleRate;
+    }
+
+private:
+    PcmReader(const PcmReader&) = delete;
+    PcmReader& operator=(const PcmReader&) = delete;
+
+    enum Format
+    {
+        PCM_S16,
+        PCM_F32
+    };
+
+    static uint32_t le32(const unsigned char *p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static uint16_t le16(const unsigned char *p)
+    {
+        return p[0] | (p[1] << 8);
+    }
+
+    bool readHeader()
+    {
+        unsigned char riff[12];
+        size_t got = fread(riff, 1, 12, file);
+        if (got < 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        {
+            // raw s16 mono, the bytes we peeked are already samples
+            format = PCM_S16;
+            channels = 1;
+            memcpy(pending, riff, got);
+            pendingBytes = got;
+            return true;
+        }
+
+        for (;;)
+        {
+            unsigned char chunk[8];
+            if (fread(chunk, 1, 8, file) != 8)
+            {
+                std::cout << "ERROR::PCM::NO_DATA_CHUNK" << std::endl;
+                return false;
+            }
+            uint32_t size = le32(chunk + 4);
+
+            if (memcmp(chunk, "fmt ", 4) == 0)
+            {
+                unsigned char fmt[40];
+                uint32_t keep = size < sizeof(fmt) ? size : sizeof(fmt);
+                if (fread(fmt, 1, keep, file) != keep)
+                    return false;
+                skip(size - keep + (size & 1));
+                if (keep < 16)
+                {
+                    std::cout << "ERROR::PCM::BAD_FORMAT fmt chunk of " << size << " bytes" << std::endl;
+                    return false;
+                }
+
+                uint16_t tag = le16(fmt);
+                channels = le16(fmt + 2);
+                sampleRate = (int)le32(fmt + 4);
+                uint16_t bits = le16(fmt + 14);
+                if (sampleRate <= 0)
+                {
+                    std::cout << "ERROR::PCM::BAD_FORMAT sample rate " << le32(fmt + 4) << std::endl;
+                    return false;
+                }
+                if (tag == 0xFFFE && keep >= 26)
+                    tag = le16(fmt + 24);      // WAVE_FORMAT_EXTENSIBLE sub format
+
+                if (tag == 1 && bits == 16)
+                    format = PCM_S16;
+                else if (tag == 3 && bits == 32)
+                    format = PCM_F32;
+                else
+                {
+                    std::cout << "ERROR::PCM::UNSUPPORTED_FORMAT tag=" << tag << " bits=" << bits << std::endl;
+                    return false;
+                }
+            }
+            else if (memcmp(chunk, "data", 4) == 0)
+            {
+                return channels > 0;
+            }
+            else
+            {
+                skip(size + (size & 1));
+            }
+        }
+    }
+
+    void skip(uint32_t bytes)
+    {
+        unsigned char buf[256];
+        while (bytes > 0)
+        {
+            uint32_t n = bytes < sizeof(buf) ? bytes : sizeof(buf);
+            if (fread(buf, 1, n, file) != n)
+                return;
+            bytes -= n;
+        }
+    }
+
+    void readLoop()
+    {
+        const int FRAMES = 1024;
+        int frameBytes = channels * (format == PCM_S16 ? 2 : 4);
+
+        unsigned char raw[FRAMES * 8 * 4];
+        float mono[FRAMES];
+        size_t carried = pendingBytes;
+        memcpy(raw, pending, pendingBytes);
+
+        auto begin = std::chrono::steady_clock::now();
+        long long pushed = 0;
+
+        while (running)
+        {
+            size_t want = (size_t)FRAMES * frameBytes;
+            if (want > sizeof(raw))
+                want = sizeof(raw) - sizeof(raw) % frameBytes;
+            size_t got = carried + fread(raw + carried, 1, want - carried, file);
+            int frames = (int)(got / frameBytes);
+            if (frames == 0)
+                break;
+
+            for (int f = 0; f < frames; f++)
+            {
+                const unsigned char *p = raw + f * frameBytes;
+                float sum = 0;
+                for (int c = 0; c < channels; c++)
+                {
+                    if (format == PCM_S16)
+                        sum += (int16_t)le16(p + c * 2) / 32768.0f;
+                    else
+                    {
+                        uint32_t bits = le32(p + c * 4);
+                        float v;
+                        memcpy(&v, &bits, 4);
+                        sum += v;
+                    }
+                }
+                mono[f] = sum / channels;
+            }
+            carried = got - frames * frameBytes;
+            memmove(raw, raw + frames * frameBytes, carried);
+
+            // the consumer never blocks us, we wait for it instead of dropping audio
+            size_t sent = 0;
+            while (running && sent < (size_t)frames)
+            {
+                sent += ring.push(mono + sent, frames - sent);
+                if (sent < (size_t)frames)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            pushed += frames;
+
+            if (realtime)
+            {
+                auto due = begin + std::chrono::microseconds(pushed * 1000000LL / sampleRate);
+                std::this_thread::sleep_until(due);
+            }
+        }
+        done = true;
+    }
+
+    SpscRingBuffer<float>& ring;
+    FILE *file = NULL;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> done{false};
+    bool realtime = false;
+
+    Format format = PCM_S16;
+    int channels = 1;
+    int sampleRate;
+
+    unsigned char pending[12];
+    size_t pendingBytes = 0;
+};
+
+
+#endif
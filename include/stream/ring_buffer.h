@@ -0,0 +1,81 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+
+// Single producer / single consumer ring of samples. The producer only writes
+// head, the consumer only writes tail, so neither side ever takes a lock or
+// waits on the other. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        data.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const
+    {
+        return data.size();
+    }
+
+    // consumer side: samples ready to pop
+    size_t available() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+    }
+
+    // producer side: room left to push
+    size_t space() const
+    {
+        return data.size() - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+    }
+
+    // Pushes as many of the count samples as fit, returns how many did.
+    size_t push(const T *samples, size_t count)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t room = data.size() - (h - tail.load(std::memory_order_acquire));
+        if (count > room)
+            count = room;
+
+        for (size_t i = 0; i < count; i++)
+            data[(h + i) & mask] = samples[i];
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Pops exactly count samples, or nothing if fewer are available.
+    bool pop(T *samples, size_t count)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) - t < count)
+            return false;
+
+        for (size_t i = 0; i < count; i++)
+            samples[i] = data[(t + i) & mask];
+
+        tail.store(t + count, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> data;
+    size_t mask;
+
+    // separate cache lines so producer and consumer don't false share
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+
+#endif
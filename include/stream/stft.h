@@ -0,0 +1,186 @@
+#ifndef STFT_H
+#define STFT_H
+
+#include <fft/fft.h>
+#include <stream/ring_buffer.h>
+
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string.h>
+
+
+enum StftWindow
+{
+    WINDOW_RECTANGULAR,
+    WINDOW_HANN,
+    WINDOW_HAMMING,
+    WINDOW_BLACKMAN
+};
+
+struct StftConfig
+{
+    int fftSize = 1024;
+    int hop = 256;
+    StftWindow window = WINDOW_HANN;
+};
+
+inline StftWindow parse_window(const char *name)
+{
+    if (strcmp(name, "rect") == 0)     return WINDOW_RECTANGULAR;
+    if (strcmp(name, "hamming") == 0)  return WINDOW_HAMMING;
+    if (strcmp(name, "blackman") == 0) return WINDOW_BLACKMAN;
+    return WINDOW_HANN;
+}
+
+// Short-time FFT over the samples in a ring buffer. Each hop pops `hop` new
+// samples, windows the last fftSize of them and runs a real FFT into the
+// fftSize/2+1 bins. Finished spectra are handed to the render thread through
+// a triple buffer: the worker always has a slot to write, the reader always
+// has a complete one to read, and swapping is a single atomic exchange, so
+// neither side ever waits. Every buffer (and the plan) is set up in the
+// constructor, a hop allocates nothing.
+template <typename T>
+class StftWorker
+{
+public:
+    typedef typename FFTW<T>::complex complex_t;
+
+    StftWorker(SpscRingBuffer<float>& ring, const StftConfig& config)
+        : ring(ring), config(config), N(config.fftSize), bins(config.fftSize / 2 + 1)
+    {
+        history = new float[N]();
+        incoming = new float[config.hop];
+        window = new T[N];
+        frame = (T*) FFTW<T>::malloc(sizeof(T) * N);
+        for (int i = 0; i < 3; i++)
+            slots[i] = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * bins);
+
+        fillWindow();
+
+        // plan on the main thread, the worker only executes it
+        plan = new RealFFTPlan<T>(N, frame, slots[0]);
+    }
+
+    ~StftWorker()
+    {
+        stop();
+        delete plan;
+        for (int i = 0; i < 3; i++)
+            FFTW<T>::free(slots[i]);
+        FFTW<T>::free(frame);
+        delete[] window;
+        delete[] incoming;
+        delete[] history;
+    }
+
+    void start()
+    {
+        running = true;
+        worker = std::thread([this]() {
+            while (running)
+            {
+                if (!step())
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        });
+    }
+
+    void stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Runs one hop if enough samples are waiting. Returns false otherwise.
+    bool step()
+    {
+        int hop = config.hop;
+        if (!ring.pop(incoming, hop))
+            return false;
+
+        if (hop < N)
+            memmove(history, history + hop, sizeof(float) * (N - hop));
+        int keep = hop < N ? hop : N;
+        memcpy(history + N - keep, incoming + hop - keep, sizeof(float) * keep);
+
+        for (int i = 0; i < N; i++)
+            frame[i] = T(history[i]) * window[i];
+
+        plan->execute(frame, slots[back]);
+
+        // publish: our finished slot becomes the ready one, take the old ready one back
+        back = ready.exchange(back | FRESH) & INDEX;
+        hops++;
+        return true;
+    }
+
+    // Render thread: the newest spectrum, or NULL if nothing new since the
+    // last call. The returned bins stay valid until the next call.
+    complex_t *latest()
+    {
+        if (!(ready.load(std::memory_order_acquire) & FRESH))
+            return NULL;
+        front = ready.exchange(front) & INDEX;
+        return slots[front];
+    }
+
+    int size() const
+    {
+        return N;
+    }
+
+    long long hopCount() const
+    {
+        return hops;
+    }
+
+private:
+    StftWorker(const StftWorker&) = delete;
+    StftWorker& operator=(const StftWorker&) = delete;
+
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    void fillWindow()
+    {
+        for (int i = 0; i < N; i++)
+        {
+            double x = 2.0 * M_PI * i / N;
+            double w;
+            switch (config.window)
+            {
+            case WINDOW_HANN:     w = 0.5 - 0.5 * std::cos(x); break;
+            case WINDOW_HAMMING:  w = 0.54 - 0.46 * std::cos(x); break;
+            case WINDOW_BLACKMAN: w = 0.42 - 0.5 * std::cos(x) + 0.08 * std::cos(2 * x); break;
+            default:              w = 1.0; break;
+            }
+            window[i] = T(w);
+        }
+    }
+
+    SpscRingBuffer<float>& ring;
+    StftConfig config;
+    int N;
+    int bins;
+
+    float *history;
+    float *incoming;
+    T *window;
+    T *frame;
+    complex_t *slots[3];
+    RealFFTPlan<T> *plan;
+
+    int back = 0;                       // worker's slot
+    int front = 1;                      // reader's slot
+    std::atomic<int> ready{2};          // slot index, FRESH when unread
+
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<long long> hops{0};
+};
+
+
+#endif
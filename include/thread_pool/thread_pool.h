@@ -0,0 +1,166 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+
+// Small fork/join pool. parallelFor hands out task indices to the workers and
+// the calling thread, and only returns once every task is done. Threads are
+// kept alive between calls so a job only costs a wake up, not a spawn.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int threads = defaultThreads())
+    {
+        resize(threads);
+    }
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    static int defaultThreads()
+    {
+        int n = (int)std::thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+    // number of threads that run tasks, counting the caller
+    int size() const
+    {
+        return (int)workers.size() + 1;
+    }
+
+    void resize(int threads)
+    {
+        if (threads < 1)
+            threads = 1;
+        if (threads == size() && started)
+            return;
+
+        stop();
+        quit = false;
+        started = true;
+        for (int i = 0; i < threads - 1; i++)
+            workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    // Runs fn(i) for every i in [0, count) and waits for all of them.
+    void parallelFor(int count, const std::function<void(int)>& fn)
+    {
+        if (count <= 0)
+            return;
+        if (count == 1 || workers.empty())
+        {
+            for (int i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::unique_lock<std::mutex> jobLock(jobMutex);   // one job at a time
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            nextTask = 0;
+            remaining = count;
+            generation++;
+        }
+        wake.notify_all();
+
+        int finished = runTasks(fn);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        remaining -= finished;
+        // workers still holding the job must leave before it can be replaced
+        done.wait(lock, [this]() { return remaining == 0 && active == 0; });
+        job = nullptr;
+    }
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers)
+            t.join();
+        workers.clear();
+    }
+
+    int runTasks(const std::function<void(int)>& fn)
+    {
+        int finished = 0;
+        for (;;)
+        {
+            int i = nextTask.fetch_add(1);
+            if (i >= jobCount)
+                break;
+            fn(i);
+            finished++;
+        }
+        return finished;
+    }
+
+    void workerLoop()
+    {
+        unsigned long seen = 0;
+        for (;;)
+        {
+            const std::function<void(int)>* fn;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return quit || (generation != seen && job); });
+                if (quit)
+                    return;
+                seen = generation;
+                fn = job;
+                active++;
+            }
+
+            int finished = runTasks(*fn);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                remaining -= finished;
+                active--;
+            }
+            done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)>* job = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextTask{0};
+    int remaining = 0;
+    int active = 0;
+    unsigned long generation = 0;
+    bool quit = false;
+    bool started = false;
+};
+
+
+#endif
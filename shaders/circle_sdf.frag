@@ -0,0 +1,27 @@
+#version 410 core
+
+// Distance to the ring and to the radius arm, turned into the coverage of a
+// one pixel wide stroke: round at any size, anti-aliased without MSAA
+
+in vec2 local;
+flat in vec2 arm;
+
+uniform float pixel;
+
+out vec4 FragColor;
+
+void main()
+{
+    float r = length(arm);
+    float ring = abs(length(local) - r);
+
+    // closest point of the segment from the centre to the end of the arm
+    float h = clamp(dot(local, arm) / max(r * r, 1e-30), 0.0, 1.0);
+    float line = length(local - arm * h);
+
+    float coverage = clamp(1.0 - min(ring, line) / pixel, 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+
+    FragColor = vec4(1.0, 1.0, 0.0, coverage);
+}
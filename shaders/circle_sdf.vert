@@ -0,0 +1,25 @@
+#version 410 core
+
+// One screen-aligned quad per circle for circle_sdf.frag, no mesh: the four
+// corners of the triangle strip come from gl_VertexID. Reads the same
+// CircleInstance attributes as shader.vert.
+
+layout (location = 1) in vec2 iPos;
+layout (location = 2) in vec2 iVec;     // radius * (cos, sin) of the current angle
+
+uniform mat4 projection;
+uniform float pixel;                    // world units per framebuffer pixel
+
+out vec2 local;                         // world offset from the centre
+flat out vec2 arm;
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    // half the one pixel stroke plus a pixel of anti-aliasing around the ring
+    local = corner * (length(iVec) + 1.5 * pixel);
+    arm = iVec;
+
+    gl_Position = projection * vec4(iPos + local, 0.0, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 410 core
+
+in vec2 uv;
+
+uniform sampler2D image;
+uniform float gain;                     // the decay, 1 when compositing
+uniform float cutoff;                   // taken off after it, see Phosphor::CUTOFF
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = max(texture(image, uv) * gain - cutoff, 0.0);
+}
@@ -0,0 +1,12 @@
+#version 410 core
+
+// One triangle over the whole viewport for include/render/phosphor.h, no
+// vertex buffer: the corners come from gl_VertexID
+
+out vec2 uv;
+
+void main()
+{
+    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,25 +1,22 @@
 #version 410 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 iPos;
-layout (location = 2) in float iRadius;
-layout (location = 3) in float iAngle;
-layout (location = 4) in float iFreq;
+// one CircleInstance (include/render/circle_instance.h) per circle
+layout (location = 1) in vec2 iPos;
+layout (location = 2) in vec2 iVec;     // radius * (cos, sin) of the current angle
 
 uniform mat4 projection;
-uniform float time;
 
 void main()
 {
-    float angle = iAngle + iFreq * time;
-
+    // rotation and scale in one, no trig per vertex
     mat2 rot = mat2(
-        cos(angle), sin(angle),
-        -sin(angle), cos(angle)
+        iVec.x, iVec.y,
+        -iVec.y, iVec.x
     );
 
     vec2 rotated = vec2(rot * aPos.xy);
 
-    vec3 world = vec3(rotated * iRadius, 0) + iPos;
+    vec3 world = vec3(rotated + iPos, 0);
     gl_Position = projection * vec4(world, 1.0);
 }
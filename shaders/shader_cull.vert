@@ -0,0 +1,28 @@
+#version 430 core
+
+// shader.vert for the culled draw: instance gl_InstanceID is the
+// visible[gl_InstanceID]-th CircleInstance of the frame, as kept by
+// circle_cull.comp, read from the same buffer the attributes would use
+
+layout (location = 0) in vec3 aPos;
+
+layout (std430, binding = 0) readonly buffer Instances { uint inst[]; };
+layout (std430, binding = 1) readonly buffer Visible { uint visible[]; };
+
+uniform mat4 projection;
+uniform uint offset;        // words to this frame's first instance
+
+void main()
+{
+    uint w = offset + 3 * visible[gl_InstanceID];
+    vec2 pos = vec2(uintBitsToFloat(inst[w]), uintBitsToFloat(inst[w + 1]));
+    vec2 vec = unpackHalf2x16(inst[w + 2]);
+
+    // rotation and scale in one, as in shader.vert
+    mat2 rot = mat2(
+        vec.x, vec.y,
+        -vec.y, vec.x
+    );
+
+    gl_Position = projection * vec4(rot * aPos.xy + pos, 0.0, 1.0);
+}
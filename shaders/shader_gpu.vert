@@ -0,0 +1,26 @@
+#version 430 core
+
+// Same circle as shader.vert, but the instance data comes straight from the
+// buffer epicycle.comp writes: x, y = centre, z, w = radius * (cos, sin)
+
+layout (location = 0) in vec3 aPos;
+
+layout (std430, binding = 1) readonly buffer Instances { vec4 inst[]; };
+
+uniform mat4 projection;
+
+void main()
+{
+    vec4 c = inst[gl_InstanceID];
+
+    // rotation and scale in one, no trig per vertex
+    mat2 rot = mat2(
+        c.z, c.w,
+        -c.w, c.z
+    );
+
+    vec2 rotated = vec2(rot * aPos.xy);
+
+    vec3 world = vec3(rotated + c.xy, 0);
+    gl_Position = projection * vec4(world, 1.0);
+}
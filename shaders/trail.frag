@@ -0,0 +1,10 @@
+#version 410 core
+
+in float fade;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.3, 0.8, 1.0, fade);
+}
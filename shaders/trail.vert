@@ -0,0 +1,20 @@
+#version 410 core
+
+// The tip's trail (include/render/trail.h), fading out with age
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in uint aTick;    // low 32 bits of the point's tick
+
+uniform mat4 projection;
+uniform uint now;                       // low 32 bits of this frame's tick
+uniform float fadeTicks;                // age at which a point is gone
+
+out float fade;
+
+void main()
+{
+    // unsigned, so right across the wrap of the 32-bit tick
+    float age = float(now - aTick);
+    fade = clamp(1.0 - age / fadeTicks, 0.0, 1.0);
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
+}
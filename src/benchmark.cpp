@@ -0,0 +1,877 @@
+#include <iostream>
+#include <fftw/fftw3.h>
+#include <fft/fft.h>
+#include <fft/batch_fft.h>
+#include <fft/sliding_dft.h>
+#include <fft/pruned_fft.h>
+#include <stream/ring_buffer.h>
+#include <stream/stft.h>
+#include <epicycle/phase_engine.h>
+#include <epicycle/curve.h>
+#include <epicycle/tip_batch.h>
+#include <epicycle/lod.h>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+// Run command: g++ -O2 -std=c++17 -Iinclude src/benchmark.cpp -lfftw3 -lfftw3f -lpthread -o benchmark
+// ./benchmark            runs everything
+// ./benchmark <name>     runs only that benchmark
+
+double now_ms()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// -------------------- plan cache / wisdom --------------------
+void bench_plan_cache()
+{
+    const char *wisdomFile = "/tmp/fourier_bench_wisdom.dat";
+    PlanCache& cache = PlanCache::instance();
+
+    printf("\n[plan_cache] plan time in ms (estimate | measure cold | measure cached | measure from wisdom)\n");
+
+    for (int logN = 6; logN <= 22; logN++)
+    {
+        int N = 1 << logN;
+        fftw_complex *in  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+
+        fftw_forget_wisdom();
+        cache.clear();
+        cache.setFlags(FFTW_ESTIMATE);
+        double t0 = now_ms();
+        cache.get(N, FFTW_FORWARD, in, out);
+        double estimate = now_ms() - t0;
+
+        fftw_forget_wisdom();
+        cache.clear();
+        cache.setFlags(FFTW_MEASURE);
+        t0 = now_ms();
+        cache.get(N, FFTW_FORWARD, in, out);
+        double cold = now_ms() - t0;
+
+        t0 = now_ms();
+        cache.get(N, FFTW_FORWARD, in, out);
+        double cached = now_ms() - t0;
+
+        cache.saveWisdom(wisdomFile);
+        fftw_forget_wisdom();
+        cache.clear();
+        cache.loadWisdom(wisdomFile);
+        t0 = now_ms();
+        cache.get(N, FFTW_FORWARD, in, out);
+        double wise = now_ms() - t0;
+
+        printf("N = 2^%-2d %10.3f %12.3f %12.5f %12.3f\n", logN, estimate, cold, cached, wise);
+
+        fftw_free(in);
+        fftw_free(out);
+    }
+
+    cache.clear();
+    fftw_forget_wisdom();
+    remove(wisdomFile);
+}
+
+// -------------------- threaded fft --------------------
+void bench_threads()
+{
+    printf("\n[threads] ms per forward transform, speedup vs 1 thread in brackets\n");
+
+    PlanCache::instance().setFlags(FFTW_MEASURE);
+    FFTThreadConfig& config = fft_thread_config();
+    config.serialCutoff = 1;
+
+    int sizes[] = {1 << 16, 1 << 18, 1 << 20, 1 << 22};
+    int threadCounts[] = {1, 2, 4, 8, 16};
+
+    for (int N : sizes)
+    {
+        fftw_complex *in  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        for (int i = 0; i < N; i++)
+        {
+            in[i][0] = std::sin(0.001 * i);
+            in[i][1] = std::cos(0.003 * i);
+        }
+
+        printf("N = %-8d", N);
+        double serial = 0;
+        for (int threads : threadCounts)
+        {
+            config.threads = threads;
+            fft_execute(N, FFTW_FORWARD, in, out);      // plan + warm up
+
+            int reps = 10;
+            double t0 = now_ms();
+            for (int r = 0; r < reps; r++)
+                fft_execute(N, FFTW_FORWARD, in, out);
+            double t = (now_ms() - t0) / reps;
+            if (threads == 1)
+                serial = t;
+            printf(" %2dT %8.3f (%4.2fx)", threads, t, serial / t);
+        }
+        printf("\n");
+
+        fftw_free(in);
+        fftw_free(out);
+    }
+
+    config = FFTThreadConfig();
+}
+
+// -------------------- float vs double --------------------
+void bench_precision()
+{
+    printf("\n[precision] ms per forward transform and float error relative to double\n");
+    printf("%-10s %10s %10s %8s %14s %14s\n", "N", "double", "float", "speedup", "rel L2 error", "max abs error");
+
+    for (int logN = 8; logN <= 22; logN += 2)
+    {
+        int N = 1 << logN;
+        fftw_complex  *inD  = (fftw_complex*)  fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex  *outD = (fftw_complex*)  fftw_malloc(sizeof(fftw_complex) * N);
+        fftwf_complex *inF  = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * N);
+        fftwf_complex *outF = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * N);
+
+        for (int i = 0; i < N; i++)
+        {
+            inD[i][0] = std::sin(0.001 * i) + 0.5 * std::cos(0.07 * i);
+            inD[i][1] = (i * 2 > N) ? 0.5 : -0.5;
+            inF[i][0] = float(inD[i][0]);
+            inF[i][1] = float(inD[i][1]);
+        }
+
+        int reps = logN < 16 ? 200 : 10;
+        fft_execute(N, FFTW_FORWARD, inD, outD);
+        double t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            fft_execute(N, FFTW_FORWARD, inD, outD);
+        double tD = (now_ms() - t0) / reps;
+
+        fft_execute(N, FFTW_FORWARD, inF, outF);
+        t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            fft_execute(N, FFTW_FORWARD, inF, outF);
+        double tF = (now_ms() - t0) / reps;
+
+        double err = 0, norm = 0, maxErr = 0;
+        for (int i = 0; i < N; i++)
+        {
+            double dr = outF[i][0] - outD[i][0];
+            double di = outF[i][1] - outD[i][1];
+            err += dr * dr + di * di;
+            norm += outD[i][0] * outD[i][0] + outD[i][1] * outD[i][1];
+            maxErr = std::max(maxErr, std::sqrt(dr * dr + di * di));
+        }
+
+        printf("2^%-8d %10.3f %10.3f %7.2fx %14.3e %14.3e\n",
+               logN, tD, tF, tD / tF, std::sqrt(err / norm), maxErr);
+
+        fftw_free(inD);
+        fftw_free(outD);
+        fftwf_free(inF);
+        fftwf_free(outF);
+    }
+}
+
+// -------------------- batched shapes --------------------
+void bench_batch()
+{
+    const int N = 512;
+    printf("\n[batch] N = %d, shapes per ms (per-shape loop | plan_many batch)\n", N);
+
+    fft_thread_config().threads = 1;
+
+    for (int K = 1; K <= 4096; K *= 4)
+    {
+        size_t total = (size_t)K * N;
+        fftw_complex *in  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * total);
+        fftw_complex *out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * total);
+        for (size_t i = 0; i < total; i++)
+        {
+            in[i][0] = std::sin(0.01 * i);
+            in[i][1] = std::cos(0.02 * i);
+        }
+
+        int reps = std::max(1, 4096 / K) * 4;
+
+        for (int s = 0; s < K; s++)
+            fft_execute(N, FFTW_FORWARD, in + (size_t)s * N, out + (size_t)s * N);
+        double t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            for (int s = 0; s < K; s++)
+                fft_execute(N, FFTW_FORWARD, in + (size_t)s * N, out + (size_t)s * N);
+        double loop = (now_ms() - t0) / reps;
+
+        fft_batch_execute(K, N, FFTW_FORWARD, in, out);
+        t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            fft_batch_execute(K, N, FFTW_FORWARD, in, out);
+        double batch = (now_ms() - t0) / reps;
+
+        printf("K = %-5d %12.1f %12.1f  (%4.2fx)\n", K, K / loop, K / batch, loop / batch);
+
+        fftw_free(in);
+        fftw_free(out);
+    }
+}
+
+// -------------------- builtin engine vs fftw --------------------
+void bench_builtin()
+{
+    printf("\n[builtin] ms per forward transform and builtin error relative to FFTW, %s passes\n",
+           fft_simd_name(fft_simd()));
+    printf("%-10s %10s %10s %8s %14s %s\n", "N", "fftw", "builtin", "ratio", "rel L2 error", "kernel");
+
+    fft_thread_config().threads = 1;
+    int sizes[] = {64, 256, 1024, 4096, 16384, 65536, 262144, 1048576,
+                   100, 1000, 3000, 10007, 100000, 1000003};
+
+    for (int N : sizes)
+    {
+        fftw_complex *in  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *ref = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        for (int i = 0; i < N; i++)
+        {
+            in[i][0] = std::sin(0.001 * i) + 0.25 * std::cos(0.37 * i);
+            in[i][1] = (i * 2 > N) ? 0.5 : -0.5;
+        }
+
+        int reps = N < 65536 ? 100 : 5;
+
+        fft_backend() = FFT_BACKEND_FFTW;
+        fft_execute(N, FFTW_FORWARD, in, ref);
+        double t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            fft_execute(N, FFTW_FORWARD, in, ref);
+        double tFFTW = (now_ms() - t0) / reps;
+
+        fft_backend() = FFT_BACKEND_BUILTIN;
+        fft_execute(N, FFTW_FORWARD, in, out);
+        t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            fft_execute(N, FFTW_FORWARD, in, out);
+        double tBuiltin = (now_ms() - t0) / reps;
+
+        double err = 0, norm = 0;
+        for (int i = 0; i < N; i++)
+        {
+            double dr = out[i][0] - ref[i][0];
+            double di = out[i][1] - ref[i][1];
+            err += dr * dr + di * di;
+            norm += ref[i][0] * ref[i][0] + ref[i][1] * ref[i][1];
+        }
+
+        printf("%-10d %10.3f %10.3f %7.2fx %14.3e %s\n", N, tFFTW, tBuiltin, tBuiltin / tFFTW,
+               std::sqrt(err / norm), builtin_plan<double>(N, FFTW_FORWARD).bluestein() ? "bluestein" : "radix-4");
+
+        fftw_free(in);
+        fftw_free(ref);
+        fftw_free(out);
+    }
+
+    fft_backend() = FFT_BACKEND_FFTW;
+}
+
+// -------------------- streaming stft --------------------
+void bench_stft()
+{
+    printf("\n[stft] hann window, hop = size / 4, hops per second on the worker\n");
+
+    fft_thread_config().threads = 1;
+    int sizes[] = {256, 512, 1024, 2048, 4096, 8192};
+    std::vector<float> chunk(1 << 16);
+    for (size_t i = 0; i < chunk.size(); i++)
+        chunk[i] = 0.5f * std::sin(0.05f * i) + 0.25f * std::sin(0.31f * i);
+
+    for (int N : sizes)
+    {
+        StftConfig config;
+        config.fftSize = N;
+        config.hop = N / 4;
+
+        SpscRingBuffer<float> ring(chunk.size());
+        StftWorker<double> stft(ring, config);
+
+        long long hops = 0;
+        double busy = 0;
+        while (busy < 500)
+        {
+            ring.push(chunk.data(), ring.space());
+            double t0 = now_ms();
+            while (stft.step())
+                hops++;
+            busy += now_ms() - t0;
+        }
+
+        printf("fft size %-6d hop %-6d %12.0f hops/s %10.1fx real time at 48kHz\n",
+               N, config.hop, hops / (busy / 1000.0), hops * config.hop / (busy / 1000.0) / 48000.0);
+    }
+}
+
+// -------------------- sliding dft --------------------
+void bench_sliding()
+{
+    printf("\n[sliding] new samples per second (full FFT per sample | sliding all bins | sliding 64 bins)\n");
+
+    fft_thread_config().threads = 1;
+    int sizes[] = {512, 4096, 32768, 262144};
+
+    for (int N : sizes)
+    {
+        fftw_complex *window = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *out    = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        for (int i = 0; i < N; i++)
+        {
+            window[i][0] = std::sin(0.01 * i);
+            window[i][1] = std::cos(0.03 * i);
+        }
+
+        // what fft_test costs when rerun for every new sample
+        int samples = std::max(4, (1 << 22) / N / 8);
+        fft_execute(N, FFTW_FORWARD, window, out);
+        double t0 = now_ms();
+        for (int s = 0; s < samples; s++)
+        {
+            window[s % N][0] += 0.001;
+            fft_execute(N, FFTW_FORWARD, window, out);
+        }
+        double full = samples / ((now_ms() - t0) / 1000.0);
+
+        SlidingDFT<double> all(N);
+        all.reset(window);
+        samples = std::max(64, (1 << 24) / N);
+        t0 = now_ms();
+        for (int s = 0; s < samples; s++)
+            all.push(std::sin(0.01 * s), 0.5);
+        double slidingAll = samples / ((now_ms() - t0) / 1000.0);
+
+        std::vector<int> lowBins;
+        for (int k = 0; k < 32; k++)
+        {
+            lowBins.push_back(k);
+            lowBins.push_back(N - 1 - k);
+        }
+        SlidingDFT<double> few(N, lowBins);
+        few.reset(window);
+        samples = 1 << 20;
+        t0 = now_ms();
+        for (int s = 0; s < samples; s++)
+            few.push(std::sin(0.01 * s), 0.5);
+        double slidingFew = samples / ((now_ms() - t0) / 1000.0);
+
+        printf("N = %-8d %14.0f %14.0f %14.0f\n", N, full, slidingAll, slidingFew);
+
+        fftw_free(window);
+        fftw_free(out);
+    }
+}
+
+// -------------------- pruned low-frequency transform --------------------
+void bench_pruned()
+{
+    printf("\n[pruned] ms for bins -K..K (DFT bank | decomposed with chosen M | full FFT)\n");
+
+    fft_thread_config().threads = 1;
+    int sizes[] = {4096, 65536, 1048576};
+    int Ks[] = {0, 1, 4, 16, 64, 256, 1024};
+
+    for (int N : sizes)
+    {
+        fftw_complex *in  = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        fftw_complex *out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
+        for (int i = 0; i < N; i++)
+        {
+            in[i][0] = std::sin(0.001 * i) + 0.25 * std::cos(0.37 * i);
+            in[i][1] = (i * 2 > N) ? 0.5 : -0.5;
+        }
+
+        int reps = std::max(1, (1 << 22) / N);
+        auto time = [&](int K, int M) {
+            fft_execute_pruned(N, K, FFTW_FORWARD, in, out, M);
+            double t0 = now_ms();
+            for (int r = 0; r < reps; r++)
+                fft_execute_pruned(N, K, FFTW_FORWARD, in, out, M);
+            return (now_ms() - t0) / reps;
+        };
+
+        for (int K : Ks)
+        {
+            if (2 * K + 1 >= N)
+                continue;
+            int M = pruned_split(N, K);
+
+            // the bank is O(K N), past a point it only burns time
+            double bank = ((2.0 * K + 1) * N < 2e8) ? time(K, 1) : -1;
+            double decomposed = time(K, M);
+            double full = time(K, N);
+
+            printf("N = %-8d K = %-5d %10.3f %10.3f (M = %-7d) %10.3f  -> %s\n", N, K, bank, decomposed, M, full,
+                   M == 1 ? "bank" : M == N ? "full" : "decomposed");
+        }
+
+        fftw_free(in);
+        fftw_free(out);
+    }
+}
+
+// -------------------- circle chains --------------------
+// the per-frame loop as main() had it: AoS circles, libm trig, serial sum
+struct AosCircle
+{
+    int ID;
+    float starting_angle;
+    float position[3];
+    float radius;
+    float frequency;
+};
+
+// The chain every circle benchmark runs: frequencies 0, 1, -1, 2, -2, ...
+// like the FFT's bins, radius 1 / (1 + i), or 0.5 / (1 + |f|)^decay for a
+// chosen decay
+std::vector<AosCircle> make_chain(int n, double decay = 0)
+{
+    std::vector<AosCircle> circles(n);
+    for (int i = 0; i < n; i++)
+    {
+        circles[i].ID = i;
+        circles[i].starting_angle = 0.37f * i;
+        circles[i].frequency = float((i % 2) ? (i + 1) / 2 : -(i / 2));
+        circles[i].radius = decay > 0
+            ? float(0.5 / std::pow(1.0 + std::fabs(circles[i].frequency), decay))
+            : 1.0f / (1 + i);
+    }
+    return circles;
+}
+
+// -------------------- fixed-point phase engine --------------------
+
+void bench_phase()
+{
+    printf("\n[phase] ns per circle per frame (libm float time | fixed-point phase + sine table)\n");
+
+    int counts[] = {512, 65536, 1 << 20};
+    for (int n : counts)
+    {
+        std::vector<AosCircle> circles = make_chain(n);
+        std::vector<float> x(n), y(n), angle(n);
+
+        int frames = std::max(4, (1 << 24) / n);
+        volatile float sink = 0;       // keeps the loops from being optimized out
+
+        // what the main loop did: float time, cos/sin per circle
+        double t0 = now_ms();
+        for (int f = 0; f < frames; f++)
+        {
+            float time = 1000.0f + f / 60.0f;
+            float px = 0, py = 0;
+            for (int i = 0; i < n; i++)
+            {
+                float a = circles[i].starting_angle + circles[i].frequency * time;
+                x[i] = px;
+                y[i] = py;
+                angle[i] = a;
+                px += circles[i].radius * std::cos(a);
+                py += circles[i].radius * std::sin(a);
+            }
+            sink = sink + px + py;
+        }
+        double libm = (now_ms() - t0) * 1e6 / ((double)frames * n);
+
+        PhaseEngine engine;
+        engine.load(circles);
+        t0 = now_ms();
+        for (int f = 0; f < frames; f++)
+        {
+            engine.evaluate(phase_ticks(1000.0 + f / 60.0), EPICYCLE_SCALAR);
+            sink = sink + engine.tipX() + engine.tipY();
+        }
+        double fixed = (now_ms() - t0) * 1e6 / ((double)frames * n);
+
+        printf("%-8d circles %10.2f %10.2f  (%4.2fx)\n", n, libm, fixed, libm / fixed);
+    }
+
+    // the precision half of the story: a float time step is 2^-5 s after
+    // three days, so the top frequency jumps by radians between frames
+    double seconds = 3 * 24 * 3600.0;
+    float f = 512;
+    float drift = std::fabs(float(seconds) + 1 / 60.0f - float(seconds)) - 1 / 60.0f;
+    printf("after 72 h a float time advances by %.5f s instead of %.5f s, frequency %.0f is off by %.2f rad per frame\n",
+           1 / 60.0 + drift, 1 / 60.0, f, std::fabs(f * drift));
+}
+
+// -------------------- SoA SIMD circle kernels --------------------
+void bench_simd()
+{
+    printf("\n[simd] ns per circle per frame, speedup vs the AoS libm loop in brackets\n");
+
+    const EpicycleKernel kernels[] = {EPICYCLE_SCALAR, EPICYCLE_SSE2, EPICYCLE_AVX2, EPICYCLE_NEON};
+    int counts[] = {512, 65536, 1 << 20};
+
+    for (int n : counts)
+    {
+        std::vector<AosCircle> circles = make_chain(n);
+
+        int frames = std::max(4, (1 << 24) / n);
+        volatile float sink = 0;
+
+        double t0 = now_ms();
+        for (int f = 0; f < frames; f++)
+        {
+            float time = f / 60.0f;
+            float px = 0, py = 0;
+            for (AosCircle& c : circles)
+            {
+                float a = c.starting_angle + c.frequency * time;
+                c.position[0] = px;
+                c.position[1] = py;
+                px += c.radius * std::cos(a);
+                py += c.radius * std::sin(a);
+            }
+            sink = sink + px + py;
+        }
+        double aos = (now_ms() - t0) * 1e6 / ((double)frames * n);
+        printf("%-8d circles  aos+libm %7.2f", n, aos);
+
+        PhaseEngine engine;
+        engine.load(circles);
+        for (EpicycleKernel kernel : kernels)
+        {
+            if (!epicycle_kernel_supported(kernel))
+                continue;
+            t0 = now_ms();
+            for (int f = 0; f < frames; f++)
+            {
+                engine.evaluate(phase_ticks(f / 60.0), kernel);
+                sink = sink + engine.tipX();
+            }
+            double t = (now_ms() - t0) * 1e6 / ((double)frames * n);
+            printf("  %s %6.2f (%4.1fx)", epicycle_kernel_name(kernel), t, aos / t);
+        }
+        printf("\n");
+    }
+
+    // every kernel has to agree with libm on the same fixed-point phases
+    int n = 4099;
+    std::vector<AosCircle> circles = make_chain(n);
+    PhaseEngine engine;
+    engine.load(circles);
+    uint64_t tick = phase_ticks(123456.789);
+    for (EpicycleKernel kernel : kernels)
+    {
+        if (!epicycle_kernel_supported(kernel))
+            continue;
+        engine.evaluate(tick, kernel);
+        double trigErr = 0, posErr = 0, px = 0, py = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double a = engine.phase(i, tick) * (2.0 * M_PI / 4294967296.0);
+            trigErr = std::max(trigErr, std::fabs(engine.cosine()[i] - std::cos(a)));
+            trigErr = std::max(trigErr, std::fabs(engine.sine()[i] - std::sin(a)));
+            posErr = std::max(posErr, std::hypot(engine.x()[i] - px, engine.y()[i] - py));
+            px += circles[i].radius * std::cos(a);
+            py += circles[i].radius * std::sin(a);
+        }
+        printf("%-6s max sin/cos error %.2e, max centre error %.2e\n", epicycle_kernel_name(kernel), trigErr, posErr);
+    }
+}
+
+// -------------------- parallel chain scan --------------------
+void bench_scan()
+{
+    printf("\n[scan] ms per frame for the whole chain (%s kernel), speedup vs 1 thread in brackets\n",
+           epicycle_kernel_name(epicycle_kernel()));
+
+    int counts[] = {100000, 1000000, 10000000};
+    int threadCounts[] = {1, 2, 4, 8, 16};
+
+    for (int n : counts)
+    {
+        std::vector<AosCircle> circles = make_chain(n);
+
+        PhaseEngine engine;
+        engine.load(circles);
+        engine.parallelCutoff = 0;
+
+        // what the instance buffer upload would read
+        std::vector<float> instances(2 * (size_t)n);
+        auto emit = [&](size_t first, size_t count) {
+            const float *x = engine.x();
+            const float *y = engine.y();
+            for (size_t i = first; i < first + count; i++)
+            {
+                instances[2 * i] = x[i];
+                instances[2 * i + 1] = y[i];
+            }
+        };
+
+        int frames = std::max(4, 100000000 / n);
+        printf("%-9d circles", n);
+        double serial = 0;
+        for (int threads : threadCounts)
+        {
+            ThreadPool pool(threads);
+            engine.evaluate(0, pool, emit);
+
+            double t0 = now_ms();
+            for (int f = 0; f < frames; f++)
+                engine.evaluate(phase_ticks(f / 60.0), pool, emit);
+            double t = (now_ms() - t0) / frames;
+            if (threads == 1)
+                serial = t;
+            printf("  %2dT %7.3f (%4.2fx)", threads, t, serial / t);
+        }
+        printf("\n");
+    }
+}
+
+void bench_curve()
+{
+    printf("\n[curve] whole path from one inverse FFT vs running the chain per point\n");
+
+    int counts[] = {512, 4096, 65536};
+    for (int n : counts)
+    {
+        std::vector<AosCircle> circles = make_chain(n);
+
+        CurveReconstruction<float> curve;
+        curve.build(circles, 4 * n);
+        int M = curve.size();
+
+        int reps = std::max(2, 20000000 / (M * 20));
+        double t0 = now_ms();
+        for (int r = 0; r < reps; r++)
+            curve.build(circles, 4 * n);
+        double build = (now_ms() - t0) / reps;
+
+        // the same M points from the chain, one evaluate per point
+        PhaseEngine engine;
+        engine.load(circles);
+        int points = std::min(M, std::max(16, 20000000 / n));
+        uint64_t step = (uint64_t)PHASE_TICK_RATE / 4;
+        t0 = now_ms();
+        for (int m = 0; m < points; m++)
+            engine.evaluate(m * step);
+        double chain = (now_ms() - t0) / points * M;
+
+        // scrubbing: a lookup per query instead of a chain evaluation
+        int queries = 1 << 20;
+        float x = 0, y = 0;
+        volatile float sink = 0;
+        t0 = now_ms();
+        for (int q = 0; q < queries; q++)
+        {
+            curve.sample((uint64_t)q * 977, x, y);
+            sink = sink + x + y;
+        }
+        double sample = (now_ms() - t0) * 1e6 / queries;
+
+        printf("%-6d circles  M=%-7d ifft %8.3f ms  chain x M %10.1f ms (%6.0fx)  sample %5.1f ns\n",
+               n, M, build, chain, chain / build, sample);
+
+        // both against the chain at the same ticks: points() where the
+        // fundamental's phase lands exactly on a point, sample() anywhere
+        // after a long uptime
+        int logM = 0;
+        while ((1 << logM) < M)
+            logM++;
+        int gridShift = std::max(0, 32 - logM - __builtin_ctz(PHASE_BASE_STEP));
+        double pointErr = 0, sampleErr = 0;
+        for (int q = 0; q < 256; q++)
+        {
+            uint64_t tick = ((uint64_t)q * 7919 + 1) << gridShift;
+            int m = (int)(((uint64_t)(uint32_t)(tick * PHASE_BASE_STEP) * M) >> 32);
+            engine.evaluate(tick);
+            pointErr = std::max<double>(pointErr, std::hypot(curve.points()[m][0] - engine.tipX(),
+                                                     curve.points()[m][1] - engine.tipY()));
+
+            tick = phase_ticks(1e6) + (uint64_t)q * 977;
+            engine.evaluate(tick);
+            curve.sample(tick, x, y);
+            sampleErr = std::max<double>(sampleErr, std::hypot(x - engine.tipX(), y - engine.tipY()));
+        }
+        printf("%-15s max error vs the chain: point %.1e  sample %.1e\n", "", pointErr, sampleErr);
+    }
+}
+
+void bench_tips()
+{
+    printf("\n[tips] tip positions for T times x N circles, million circle-times per second\n");
+
+    int counts[] = {1024, 16384, 262144};
+    size_t times[] = {64, 4096};
+
+    for (int n : counts)
+    {
+        std::vector<AosCircle> circles = make_chain(n);
+        TipBatch batch;
+        batch.load(circles);
+
+        // the reference: a double sum over the chain at the same fixed-point phases
+        PhaseEngine engine;
+        engine.load(circles);
+        auto reference = [&](uint64_t tick, double& rx, double& ry) {
+            rx = ry = 0;
+            for (int i = 0; i < n; i++)
+            {
+                double a = engine.phase(i, tick) * (2.0 * M_PI / 4294967296.0);
+                rx += circles[i].radius * std::cos(a);
+                ry += circles[i].radius * std::sin(a);
+            }
+        };
+
+        for (size_t T : times)
+        {
+            // random times, 60 fps frames, and a step that divides a turn in 2^16
+            std::vector<uint64_t> randomTicks(T), frameTicks(T), gridTicks(T);
+            uint64_t seed = 12345;
+            for (size_t k = 0; k < T; k++)
+            {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                randomTicks[k] = seed >> 24;
+                frameTicks[k] = 1000 + k * phase_ticks(1.0 / 60.0);
+                gridTicks[k] = 1000 + k * 65536;
+            }
+            std::vector<float> x(T), y(T);
+
+            struct Run { const char *name; const std::vector<uint64_t> *ticks; TipMethod method; };
+            Run runs[] = {
+                {"direct", &randomTicks, TIP_DIRECT},
+                {"recurrence", &frameTicks, TIP_RECURRENCE},
+                {"ifft", &gridTicks, TIP_IFFT},
+                {"auto 60fps", &frameTicks, TIP_AUTO},
+            };
+
+            printf("N %-7d T %-5zu", n, T);
+            double errors[4];
+            for (int m = 0; m < 4; m++)
+            {
+                const Run& r = runs[m];
+                ThreadPool& pool = ThreadPool::instance();
+                TipMethod ran = batch.evaluate(r.ticks->data(), T, x.data(), y.data(), pool, r.method);
+                int reps = std::max<int>(1, int(2e8 / (double(T) * n)));
+                double t0 = now_ms();
+                for (int i = 0; i < reps; i++)
+                    batch.evaluate(r.ticks->data(), T, x.data(), y.data(), pool, r.method);
+                double t = (now_ms() - t0) / reps;
+                printf("  %s%s%s %8.1f", r.name, r.method == TIP_AUTO ? "->" : "",
+                       r.method == TIP_AUTO ? tip_method_name(ran) : "", double(T) * n / (t * 1e3));
+
+                // 16 of the times, spread over the whole run
+                errors[m] = 0;
+                for (size_t s = 0; s < 16; s++)
+                {
+                    size_t k = s * (T - 1) / 15;
+                    double rx, ry;
+                    reference((*r.ticks)[k], rx, ry);
+                    errors[m] = std::max(errors[m], std::hypot(x[k] - rx, y[k] - ry));
+                }
+            }
+            printf("\n%-17s max error vs double", "");
+            for (int m = 0; m < 4; m++)
+                printf("  %s %.1e", runs[m].name, errors[m]);
+            printf("\n");
+        }
+    }
+}
+
+void bench_lod()
+{
+    printf("\n[lod] chain cut where the tail bound drops below a pixel threshold (1920 px wide)\n");
+    printf("      error is the measured max tip distance from the full chain, in pixels\n");
+
+    const float worldPerPixel = lod_world_per_pixel(1920);
+    int counts[] = {512, 65536};
+    float thresholds[] = {0.25f, 0.5f, 1.0f, 2.0f, 4.0f};
+    // 1/f^2 is a smooth path, 1/f one with corners (a slow tail)
+    double decays[] = {2.0, 1.0};
+
+    for (int n : counts)
+    {
+        for (double decay : decays)
+        {
+            std::vector<AosCircle> circles = make_chain(n, decay);
+
+            PhaseEngine engine;
+            engine.load(circles);
+            ChainLod lod;
+            lod.build(circles);
+
+            const int frames = 1000;
+            std::vector<float> fullX(frames), fullY(frames);
+            double t0 = now_ms();
+            for (int f = 0; f < frames; f++)
+            {
+                engine.evaluate(phase_ticks(f * 0.0137));
+                fullX[f] = engine.tipX();
+                fullY[f] = engine.tipY();
+            }
+            double full = (now_ms() - t0) / frames;
+
+            printf("%-6d circles 1/f^%.0f  full %7.4f ms\n", n, decay, full);
+            for (float px : thresholds)
+            {
+                ChainLod::Cut cut = lod.cut(px * worldPerPixel);
+                engine.limit(cut.count);
+
+                double err = 0;
+                t0 = now_ms();
+                for (int f = 0; f < frames; f++)
+                {
+                    engine.evaluate(phase_ticks(f * 0.0137));
+                    double dx = engine.tipX() + cut.offsetX - fullX[f];
+                    double dy = engine.tipY() + cut.offsetY - fullY[f];
+                    err = std::max(err, std::sqrt(dx * dx + dy * dy));
+                }
+                double t = (now_ms() - t0) / frames;
+                engine.limit(n);
+
+                printf("   %5.2f px  keep %6zu (%5.1f%%)  %7.4f ms (%5.1fx)  error %6.3f px  envelope %6.3f px\n",
+                       px, cut.count, 100.0 * cut.count / n, t, full / t,
+                       err / worldPerPixel, cut.envelope / worldPerPixel);
+            }
+        }
+    }
+}
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)();
+};
+
+int main(int argc, char **argv)
+{
+    Benchmark benchmarks[] = {
+        {"plan_cache", bench_plan_cache},
+        {"threads", bench_threads},
+        {"precision", bench_precision},
+        {"batch", bench_batch},
+        {"builtin", bench_builtin},
+        {"stft", bench_stft},
+        {"sliding", bench_sliding},
+        {"pruned", bench_pruned},
+        {"phase", bench_phase},
+        {"simd", bench_simd},
+        {"scan", bench_scan},
+        {"curve", bench_curve},
+        {"tips", bench_tips},
+        {"lod", bench_lod},
+    };
+
+    for (const Benchmark& b : benchmarks)
+    {
+        if (argc > 1 && strcmp(argv[1], b.name) != 0)
+            continue;
+        b.run();
+    }
+    return 0;
+}
@@ -1,11 +1,36 @@
 #include <iostream>
 #include <fstream>
 #include <glad/glad.h>
+#ifndef RENDER_NO_GLFW
 #include <GLFW/glfw3.h>
+#else
+typedef struct GLFWwindow GLFWwindow;   // headless only, never created
+#endif
 #include <shader/shader.h>
 #include <fftw/fftw3.h>
+#include <fft/fft.h>
+#include <fft/sliding_dft.h>
+#include <fft/pruned_fft.h>
+#include <fft/coefficient_select.h>
+#include <stream/ring_buffer.h>
+#include <stream/pcm_reader.h>
+#include <stream/stft.h>
+#include <epicycle/phase_engine.h>
+#include <epicycle/gpu_chain.h>
+#include <epicycle/curve.h>
+#include <epicycle/tip_batch.h>
+#include <epicycle/lod.h>
+#include <gl_ext/gl_ext.h>
+#include <render/instance_stream.h>
+#include <render/circle_instance.h>
+#include <render/circle_mesh_lod.h>
+#include <render/gpu_cull.h>
+#include <render/trail.h>
+#include <render/phosphor.h>
+#include <render/headless.h>
 #include <cmath>
 #include <stdio.h>
+#include <string.h>
 #include <random>
 
 #include <glm/glm.hpp>
@@ -22,8 +47,34 @@ const int WINDOW_HEIGHT = 600;
 
 const char *vertexCodeString = "./shaders/shader.vert";
 const char *fragmentCodeString = "./shaders/shader.frag";
-
-float find_angle(fftw_complex arr){
+const char *gpuVertexCodeString = "./shaders/shader_gpu.vert";
+const char *sdfVertexCodeString = "./shaders/circle_sdf.vert";
+const char *sdfFragmentCodeString = "./shaders/circle_sdf.frag";
+const char *computeCodeString = "./shaders/epicycle.comp";
+const char *cullVertexCodeString = "./shaders/shader_cull.vert";
+const char *cullComputeCodeString = "./shaders/circle_cull.comp";
+const char *trailVertexCodeString = "./shaders/trail.vert";
+const char *trailFragmentCodeString = "./shaders/trail.frag";
+const char *phosphorVertexCodeString = "./shaders/phosphor.vert";
+const char *phosphorFragmentCodeString = "./shaders/phosphor.frag";
+const char *wisdomFileString = "./fftw_wisdom.dat";
+
+// Trail of the tip: points kept on the GPU, most appended per frame, and the
+// spacing in pixels the sub-frame samples aim for when the tip moves fast
+const size_t TRAIL_CAPACITY = 1 << 16;
+const size_t TRAIL_PER_FRAME = 64;
+const double TRAIL_SPACING_PIXELS = 2.0;
+
+// FFT precision: double for accuracy, -DFFT_SCALAR_FLOAT for float, which
+// halves the FFT memory traffic (link -lfftw3f instead of -lfftw3)
+#ifdef FFT_SCALAR_FLOAT
+typedef float Scalar;
+#else
+typedef double Scalar;
+#endif
+
+template <typename T>
+float find_angle(const T arr[2]){
     return std::atan2(arr[1], arr[0]);
 }
 
@@ -34,23 +85,76 @@ float test_func(float x){
     return -0.5;
 }
 
-fftw_complex *fft_test(int N, int direction){
-    fftw_complex *in, *out;
-    fftw_plan p;
+// T picks the precision: double runs fftw_*, float runs fftwf_* (link -lfftw3f)
+template <typename T>
+typename FFTW<T>::complex *fft_test(int N, int direction){
+    typedef typename FFTW<T>::complex complex_t;
+    complex_t *in, *out;
 
-    in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
-    out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * N);
-    p = fftw_plan_dft_1d(N, in, out, direction, FFTW_ESTIMATE);
+    in = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+    out = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
 
     for (int x = 0; x < N; x++){
         in[x][0] = 1;
         in[x][1] = test_func(float(x)/N);
     }
 
-    fftw_execute(p);
+    // cached plans, threaded above fft_thread_config().serialCutoff
+    fft_execute(N, direction, in, out);
+
+    FFTW<T>::free(in); 
+    return out;
+}
+
+// Like fft_test, but only bins -K..K (the first 2K+1 circles) are computed,
+// the rest of the returned N coefficients are zero.
+template <typename T>
+typename FFTW<T>::complex *fft_test_pruned(int N, int K, int direction){
+    typedef typename FFTW<T>::complex complex_t;
+    complex_t *in, *out;
+
+    in = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+    out = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * N);
+
+    for (int x = 0; x < N; x++){
+        in[x][0] = 1;
+        in[x][1] = test_func(float(x)/N);
+    }
+
+    fft_execute_pruned(N, K, direction, in, out);
+
+    FFTW<T>::free(in); 
+    return out;
+}
+
+// Real-valued input only needs half the spectrum: the other half is the
+// complex conjugate (X[N-k] = conj(X[k])). Returns N/2+1 coefficients.
+template <typename T>
+typename FFTW<T>::complex *fft_test_real(int N){
+    typedef typename FFTW<T>::complex complex_t;
+    T *in;
+    complex_t *out;
+
+    in = (T*) FFTW<T>::malloc(sizeof(T) * N);
+    out = (complex_t*) FFTW<T>::malloc(sizeof(complex_t) * (N / 2 + 1));
+
+    for (int x = 0; x < N; x++){
+        in[x] = test_func(float(x)/N);
+    }
+
+    fft_execute_r2c(N, in, out);
+
+    FFTW<T>::free(in);
+    return out;
+}
+
+// Inverse of fft_test_real, takes N/2+1 coefficients and returns N reals (unnormalized).
+// The coefficient array is used as scratch by FFTW and is overwritten.
+template <typename T>
+T *ifft_real(T (*coefficients)[2], int N){
+    T *out = (T*) FFTW<T>::malloc(sizeof(T) * N);
 
-    fftw_destroy_plan(p);
-    fftw_free(in); 
+    fft_execute_c2r(N, coefficients, out);
     return out;
 }
 
@@ -65,6 +169,20 @@ int mapIndex(int i, int N){
     return fftIndex;
 }
 
+// Coefficient k of an N-point spectrum. With a half (r2c) spectrum the
+// negative frequencies are rebuilt from their conjugate pair on demand.
+template <typename T>
+void getCoefficient(const T (*output)[2], int k, int N, bool hermitian, T result[2]){
+    if (hermitian && k > N / 2){
+        result[0] = output[N - k][0];
+        result[1] = -output[N - k][1];
+    }
+    else {
+        result[0] = output[k][0];
+        result[1] = output[k][1];
+    }
+}
+
 class Circle
 {
 public:
@@ -74,24 +192,25 @@ public:
     float radius;
     float frequency;
 
-    Circle(int ID, fftw_complex *output, int N) 
+    // GPU side is always float, T is only the precision the FFT ran in
+    template <typename T>
+    Circle(int ID, const T (*output)[2], int N, bool hermitian = false) 
     {
-        int k = mapIndex(ID, N);
-        double *complex = output[k];
-        printf("1: %f, 2: %f\n", complex[0], complex[1]);
-
-        float x = 0;
-        float y = 0;
-        float normal = float(output[0][0]) * 2;
-        int prevI;
-        for (int i = ID - 1; i >= 0; i--){
+        position = glm::vec3(0.0f);
+        update(ID, output, N, hermitian);
+    }
 
-            prevI = mapIndex(i, N);
+    // Recomputes radius, angle and frequency in place for the i-th circle of
+    // the chain, used when a new spectrum streams in
+    template <typename T>
+    void update(int i, const T (*output)[2], int N, bool hermitian = false)
+    {
+        int k = mapIndex(i, N);
+        T complex[2];
+        getCoefficient(output, k, N, hermitian, complex);
 
-            x += output[prevI][0];
-            y += output[prevI][1];
-        }
-        position = glm::vec3(0.0f);
+        // a real signal can have no DC term, so scale those by the size instead
+        float normal = hermitian ? float(N) * 2 : float(output[0][0]) * 2;
 
         this->ID = k;
         this->starting_angle = find_angle(complex);
@@ -115,28 +234,282 @@ public:
     {
         if (VAO)         glDeleteVertexArrays(1, &VAO);
         if (meshVBO)     glDeleteBuffers(1, &meshVBO);
-        if (instanceVBO) glDeleteBuffers(1, &instanceVBO);
+        if (indirectBuffer) glDeleteBuffers(1, &indirectBuffer);
         if (myShader.ID) glDeleteProgram(myShader.ID);
+        if (gpuVAO)      glDeleteVertexArrays(1, &gpuVAO);
+        if (curveVAO)    glDeleteVertexArrays(1, &curveVAO);
+        if (curveVBO)    glDeleteBuffers(1, &curveVBO);
+        if (gpuShader)   glDeleteProgram(gpuShaderProgram.ID);
+        if (sdfShader)   glDeleteProgram(sdfShaderProgram.ID);
+        if (cullShader)  glDeleteProgram(cullShaderProgram.ID);
+        if (trailShader) glDeleteProgram(trailShaderProgram.ID);
     }
 
-    void init(int w, int h, const char* vsFile, const char* fsFile)
+    void init(int w, int h, const char* vsFile, const char* fsFile,
+              UploadStrategy upload = UPLOAD_ORPHAN)
     {
         windowWidth  = w;
         windowHeight = h;
 
         myShader.init(vsFile, fsFile);
+        multiDrawIndirect = gl_ext_multi_draw_indirect();
         setupCircleMesh();
-        setupInstanceBuffer();
+        setUploadStrategy(upload);
         updateProjection(windowWidth, windowHeight);
     }
 
     void setCircles(const std::vector<Circle>& c)
     {
-        circles = c;
-        for (int i = 0; i < c.size(); i++){
-            printf("circle %i, pos: %f, %f, radius: %f, angle: %f\n", c[i].ID, c[i].position[0], c[i].position[1], c[i].radius, c[i].starting_angle);
+        CircleInstance *dst = mapInstances(c.size());
+        for (size_t i = 0; i < c.size(); i++)
+            dst[i] = pack_circle_instance(c[i].position.x, c[i].position.y, c[i].radius,
+                                          std::cos(c[i].starting_angle), std::sin(c[i].starting_angle));
+        commitInstances();
+    }
+
+    // How instances reach the GPU each frame, see instance_stream.h
+    void setUploadStrategy(UploadStrategy upload)
+    {
+        stream.init(upload);
+        instanceCount = 0;
+    }
+
+    UploadStrategy uploadStrategy() const
+    {
+        return stream.current();
+    }
+
+    // This frame's instances are written straight to the returned memory
+    // (mapped GPU memory for map-ring and persistent), in order and without
+    // reading it back, then commitInstances() before drawing
+    CircleInstance *mapInstances(size_t count)
+    {
+        instanceCount = count;
+        legacyLayout = false;
+        return (CircleInstance*)stream.map((GLsizeiptr)(count * sizeof(CircleInstance)));
+    }
+
+    // The old layout, whole Circle structs, only kept so --bench-upload can
+    // compare the two; draws centres right but not the circles themselves
+    Circle *mapCircleInstances(size_t count)
+    {
+        instanceCount = count;
+        legacyLayout = true;
+        return (Circle*)stream.map((GLsizeiptr)(count * sizeof(Circle)));
+    }
+
+    void commitInstances()
+    {
+        instanceBase = stream.commit();
+        bindInstanceAttributes(instanceBase);
+    }
+
+    // GPU chain path (GL 4.3): a second program that reads the instances from
+    // the compute shader's buffer, and a VAO with only the circle mesh
+    void initGpu(const char* vsFile, const char* fsFile)
+    {
+        gpuShaderProgram.init(vsFile, fsFile);
+        gpuShader = true;
+
+        glGenVertexArrays(1, &gpuVAO);
+        glBindVertexArray(gpuVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                              3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        updateProjection(windowWidth, windowHeight);
+    }
+
+    void drawGpu(const GpuChain& chain)
+    {
+        if (!gpuShader || !gpuVAO) return;
+
+        gpuShaderProgram.use();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, chain.instanceBuffer());
+        glBindVertexArray(gpuVAO);
+
+        glDrawArraysInstanced(
+            GL_LINE_STRIP,
+            0,
+            vertexCount,
+            static_cast<GLsizei>(chain.size())
+        );
+    }
+
+    // Ring mode: one quad per circle, ring and arm drawn by a distance field
+    // in the fragment shader instead of the 122 vertex line strip. Vertex
+    // work no longer depends on the circle, fragment work follows its size
+    // on screen, and the edges are anti-aliased without MSAA
+    void initSdf(const char* vsFile, const char* fsFile)
+    {
+        sdfShaderProgram.init(vsFile, fsFile);
+        sdfShader = true;
+        updateProjection(windowWidth, windowHeight);
+    }
+
+    void useSdf(bool on)
+    {
+        sdf = on && sdfShader;
+    }
+
+    bool usingSdf() const
+    {
+        return sdf;
+    }
+
+    // GPU culling (GL 4.3): before the draw a compute pass drops every
+    // circle outside the view or under minPixels of radius, the draw takes
+    // its instance count from the GPU, see gpu_cull.h. Draws the fixed mesh
+    void initCull(const char* vsFile, const char* fsFile, const char* computeFile)
+    {
+        cullShaderProgram.init(vsFile, fsFile);
+        cullOffsetLoc = glGetUniformLocation(cullShaderProgram.ID, "offset");
+        culler.init(computeFile);
+        cullShader = true;
+        updateProjection(windowWidth, windowHeight);
+    }
+
+    void useCull(bool on, float minPixels = 0.0f)
+    {
+        culling = on && cullShader;
+        cullPixels = minPixels;
+    }
+
+    bool usingCull() const
+    {
+        return culling;
+    }
+
+    // circles the last culled draw kept, waits for the GPU
+    unsigned culledCount() const
+    {
+        return culler.visibleCount();
+    }
+
+    // The tip's trail, see trail.h: points are appended to tipTrail() and
+    // drawn fading out over fadeTicks
+    void initTrail(const char* vsFile, const char* fsFile, size_t capacity, size_t perFrame)
+    {
+        trailShaderProgram.init(vsFile, fsFile);
+        trailNowLoc = glGetUniformLocation(trailShaderProgram.ID, "now");
+        trailFadeLoc = glGetUniformLocation(trailShaderProgram.ID, "fadeTicks");
+        trail.init(capacity, perFrame);
+        trailShader = true;
+        updateProjection(windowWidth, windowHeight);
+    }
+
+    Trail& tipTrail()
+    {
+        return trail;
+    }
+
+    void drawTrail(uint64_t tick, float fadeTicks)
+    {
+        if (!trailShader) return;
+
+        drawTrailLines(tick, fadeTicks, (size_t)-1);
+        trail.fence();
+    }
+
+    // The trail kept as an image instead (--phosphor, see phosphor.h): only
+    // the newest points of tipTrail() are drawn, into the feedback buffer
+    // after it is faded by decay, and the buffer goes onto the frame.
+    // Needs initTrail() as well; tipTrail() then only has to hold a frame.
+    void initPhosphor(const char* vsFile, const char* fsFile, float scale)
+    {
+        phosphor.init(vsFile, fsFile);
+        phosphorOn = true;
+        setPhosphorScale(scale);
+    }
+
+    // resolution of the feedback buffer, a fraction of the framebuffer's
+    void setPhosphorScale(float scale)
+    {
+        phosphorScale = scale;
+        if (phosphorOn)
+            phosphor.resize(windowWidth, windowHeight, phosphorScale);
+    }
+
+    const Phosphor& phosphorBuffer() const
+    {
+        return phosphor;
+    }
+
+    void drawPhosphor(uint64_t tick, float fadeTicks, size_t newest, float decay)
+    {
+        if (!phosphorOn || !trailShader) return;
+
+        phosphor.begin(decay);
+        drawTrailLines(tick, fadeTicks, newest, true);
+        phosphor.end();
+        trail.fence();
+    }
+
+    // Centre of the view in world units and its magnification, 1 shows
+    // [-1, 1] across the width
+    void setView(float x, float y, float zoom)
+    {
+        viewX = x;
+        viewY = y;
+        viewZoom = zoom > 0 ? zoom : 1.0f;
+        updateProjection(windowWidth, windowHeight);
+    }
+
+    // Adaptive tessellation: each circle drawn with the coarsest mesh that
+    // still looks round at its size on screen, see circle_mesh_lod.h. The
+    // caller builds adaptiveMesh() from the circles, assigns it each frame
+    // and writes circle i's instance to its slot
+    void useAdaptiveMesh(bool on)
+    {
+        adaptive = on;
+    }
+
+    bool usingAdaptiveMesh() const
+    {
+        return adaptive;
+    }
+
+    CircleMeshLod& adaptiveMesh()
+    {
+        return meshLod;
+    }
+
+    // The traced path as one line loop, only uploaded when it is rebuilt
+    void setCurve(const std::vector<float>& verts)
+    {
+        if (!curveVAO)
+        {
+            glGenVertexArrays(1, &curveVAO);
+            glGenBuffers(1, &curveVBO);
+            glBindVertexArray(curveVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, curveVBO);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                                  3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
         }
-        updateInstanceBuffer();
+
+        glBindBuffer(GL_ARRAY_BUFFER, curveVBO);
+        glBufferData(GL_ARRAY_BUFFER,
+                     verts.size() * sizeof(float),
+                     verts.data(),
+                     GL_STATIC_DRAW);
+        curveCount = static_cast<int>(verts.size() / 3);
+    }
+
+    void drawCurve()
+    {
+        if (!myShader.ID || !curveVAO || !curveCount) return;
+
+        myShader.use();
+        glBindVertexArray(curveVAO);
+
+        // the instance attributes aren't arrays in this VAO, their constant
+        // values (no offset, unit radius vector) make shader.vert an identity
+        glVertexAttrib2f(1, 0.0f, 0.0f);
+        glVertexAttrib2f(2, 1.0f, 0.0f);
+
+        glDrawArrays(GL_LINE_LOOP, 0, curveCount);
     }
 
     // Call this if the window is resized
@@ -145,34 +518,124 @@ public:
         windowWidth  = (w > 0) ? w : 1;
         windowHeight = (h > 0) ? h : 1;
         updateProjection(windowWidth, windowHeight);
+        if (phosphorOn)
+            phosphor.resize(windowWidth, windowHeight, phosphorScale);
     }
 
+    // the instances already hold every circle's current angle
     void draw()
     {
         if (!myShader.ID || !VAO) return;
 
-        float time = (float)glfwGetTime();
+        glBindVertexArray(VAO);
 
-        myShader.use();
+        if (sdf)
+        {
+            // coverage goes out as alpha; the mesh attribute stays enabled
+            // in the VAO but circle_sdf.vert doesn't read it
+            sdfShaderProgram.use();
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instanceCount));
+            glDisable(GL_BLEND);
+        }
+        else if (adaptive)
+        {
+            myShader.use();
+            drawAdaptive();
+        }
+        else if (culling)
+        {
+            drawCulled();
+        }
+        else
+        {
+            myShader.use();
+            glDrawArraysInstanced(
+                GL_LINE_STRIP,
+                0,
+                vertexCount,
+                static_cast<GLsizei>(instanceCount)
+            );
+        }
+        stream.fence();
+    }
 
-        int timeLoc = glGetUniformLocation(myShader.ID, "time");
-        glUniform1f(timeLoc, time);
+    // One point per instance with rasterization off: the GPU still reads
+    // every instance, for timing the upload on its own (--bench-upload)
+    void drawInstancePoints()
+    {
+        if (!myShader.ID || !VAO) return;
 
+        myShader.use();
         glBindVertexArray(VAO);
-
-        glDrawArraysInstanced(
-            GL_LINE_STRIP,
-            0,
-            vertexCount,
-            static_cast<GLsizei>(circles.size())
-        );
+        glEnable(GL_RASTERIZER_DISCARD);
+        glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(instanceCount));
+        glDisable(GL_RASTERIZER_DISCARD);
+        stream.fence();
     }
     
 private:
+    // One indirect command per mesh level, from the buffer rebuilt every
+    // frame. Without multi-draw indirect (macOS stops at 4.1, where
+    // baseInstance must be 0) a draw per level with the instance attributes
+    // pointed at that level's first instance does the same
+    void drawAdaptive()
+    {
+        const DrawArraysIndirectCommand *commands = meshLod.commands();
+
+        if (multiDrawIndirect)
+        {
+            if (!indirectBuffer)
+                glGenBuffers(1, &indirectBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                         CircleMeshLod::LEVELS * sizeof(DrawArraysIndirectCommand),
+                         commands,
+                         GL_STREAM_DRAW);
+            glMultiDrawArraysIndirect(GL_LINE_STRIP, (void*)0, CircleMeshLod::LEVELS, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            return;
+        }
+
+        for (int l = 0; l < CircleMeshLod::LEVELS; l++)
+        {
+            if (!commands[l].instanceCount)
+                continue;
+            bindInstanceAttributes(instanceBase + commands[l].baseInstance * sizeof(CircleInstance));
+            glDrawArraysInstanced(GL_LINE_STRIP, commands[l].first, commands[l].count,
+                                  commands[l].instanceCount);
+        }
+        bindInstanceAttributes(instanceBase);
+    }
+
+    // The cull pass, then the draw it wrote the command for. The view is
+    // grown by a pixel so circles whose stroke touches its edge stay
+    void drawCulled()
+    {
+        float pixel = lod_world_per_pixel(windowWidth, viewZoom);
+        float halfWidth = 1.0f / viewZoom + pixel;
+        float halfHeight = float(windowHeight) / float(windowWidth) / viewZoom + pixel;
+        glm::vec4 view(viewX - halfWidth, viewY - halfHeight, viewX + halfWidth, viewY + halfHeight);
+
+        culler.cull(stream.buffer(), instanceBase, (unsigned)instanceCount,
+                    view, cullPixels * pixel, (GLuint)vertexCount);
+
+        cullShaderProgram.use();
+        glUniform1ui(cullOffsetLoc, culler.instanceOffset());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stream.buffer());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, culler.visibleBuffer());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.commandBuffer());
+        glDrawArraysIndirect(GL_LINE_STRIP, (void*)0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
     void setupCircleMesh()
     {
-        std::vector<float> verts;
-        verts.reserve((SEGMENT_NUMBER + 2) * 3);
+        // the fixed mesh first, the adaptive levels after it in the same buffer
+        std::vector<float> verts, levels;
+        meshLod.vertices(levels);
+        verts.reserve((SEGMENT_NUMBER + 2) * 3 + levels.size());
 
         float twoPi = 2.0f * static_cast<float>(M_PI);
 
@@ -189,6 +652,8 @@ private:
         }
 
         vertexCount = static_cast<int>(verts.size() / 3);
+        meshLod.setBase(vertexCount);
+        verts.insert(verts.end(), levels.begin(), levels.end());
 
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &meshVBO);
@@ -206,63 +671,57 @@ private:
         glEnableVertexAttribArray(0);
     }
 
-    void setupInstanceBuffer()
+    // The newest points of the trail, faded by age. With points as well,
+    // each point lights its pixel even when the frame's stretch of line is
+    // too short to cover a pixel centre, as happens to a slow tip
+    void drawTrailLines(uint64_t tick, float fadeTicks, size_t newest, bool points = false)
     {
-        glGenBuffers(1, &instanceVBO);
+        trailShaderProgram.use();
+        glUniform1ui(trailNowLoc, (GLuint)tick);
+        glUniform1f(trailFadeLoc, fadeTicks);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        trail.draw(newest);
+        if (points)
+            trail.draw(newest, GL_POINTS);
+        glDisable(GL_BLEND);
+    }
 
+    // The stream's buffer and this frame's offset in it change per frame
+    // (ring strategies), so the instance attributes are pointed there each time
+    void bindInstanceAttributes(GLintptr base)
+    {
         glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
 
-        // allocate 0 for now; real size in updateInstanceBuffer()
-        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        if (!legacyLayout)
+        {
+            circle_instance_attributes(base);
+            return;
+        }
 
-        // Attribute 1: Circle.position (vec3)
+        // Circle.position.xy and (radius, frequency) in place of the radius vector
         glVertexAttribPointer(
-            1, 3, GL_FLOAT, GL_FALSE,
-            sizeof(Circle), (void*)offsetof(Circle, position)
+            1, 2, GL_FLOAT, GL_FALSE,
+            sizeof(Circle), (void*)(base + offsetof(Circle, position))
         );
         glEnableVertexAttribArray(1);
         glVertexAttribDivisor(1, 1);
-
-        // Attribute 2: Circle.radius (float)
         glVertexAttribPointer(
-            2, 1, GL_FLOAT, GL_FALSE,
-            sizeof(Circle), (void*)offsetof(Circle, radius)
+            2, 2, GL_FLOAT, GL_FALSE,
+            sizeof(Circle), (void*)(base + offsetof(Circle, radius))
         );
         glEnableVertexAttribArray(2);
         glVertexAttribDivisor(2, 1);
-        // Attribute 3: Circle.starting_angle (float)
-        glVertexAttribPointer(
-            3, 1, GL_FLOAT, GL_FALSE,
-            sizeof(Circle), (void*)offsetof(Circle, starting_angle)
-        );
-        glEnableVertexAttribArray(3);
-        glVertexAttribDivisor(3, 1);
-        // Attribute 4: Circle.frequency (float)
-        glVertexAttribPointer(
-            4, 1, GL_FLOAT, GL_FALSE,
-            sizeof(Circle), (void*)offsetof(Circle, frequency)
-        );
-        glEnableVertexAttribArray(4);
-        glVertexAttribDivisor(4, 1);
-    }
-
-    void updateInstanceBuffer()
-    {
-        // Upload your circles directly (NO CircleInstanceGPU, no copying)
-        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-        glBufferData(GL_ARRAY_BUFFER,
-                     circles.size() * sizeof(Circle),
-                     circles.data(),
-                     GL_DYNAMIC_DRAW);
     }
 
     void updateProjection(int w, int h)
     {
         float aspect = static_cast<float>(h) / static_cast<float>(w);
+        float halfWidth = 1.0f / viewZoom;
 
-        glm::mat4 proj = glm::ortho(-1.0f, 1.0f,
-                                    -aspect, aspect);
+        glm::mat4 proj = glm::ortho(viewX - halfWidth, viewX + halfWidth,
+                                    viewY - aspect * halfWidth, viewY + aspect * halfWidth);
 
         myShader.use();
         GLint loc = glGetUniformLocation(myShader.ID, "projection");
@@ -270,20 +729,88 @@ private:
         {
             glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(proj));
         }
+
+        if (gpuShader)
+        {
+            gpuShaderProgram.use();
+            loc = glGetUniformLocation(gpuShaderProgram.ID, "projection");
+            if (loc != -1)
+                glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(proj));
+        }
+
+        if (sdfShader)
+        {
+            sdfShaderProgram.use();
+            loc = glGetUniformLocation(sdfShaderProgram.ID, "projection");
+            if (loc != -1)
+                glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(proj));
+            loc = glGetUniformLocation(sdfShaderProgram.ID, "pixel");
+            if (loc != -1)
+                glUniform1f(loc, lod_world_per_pixel(w, viewZoom));
+        }
+
+        if (cullShader)
+        {
+            cullShaderProgram.use();
+            loc = glGetUniformLocation(cullShaderProgram.ID, "projection");
+            if (loc != -1)
+                glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(proj));
+        }
+
+        if (trailShader)
+        {
+            trailShaderProgram.use();
+            loc = glGetUniformLocation(trailShaderProgram.ID, "projection");
+            if (loc != -1)
+                glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(proj));
+        }
     }
 
 private:
     GLuint VAO = 0;
     GLuint meshVBO = 0;
-    GLuint instanceVBO = 0;
+    InstanceStream stream;
+    size_t instanceCount = 0;
+    GLintptr instanceBase = 0;
+    bool legacyLayout = false;
+    CircleMeshLod meshLod;
+    bool adaptive = false;
+    bool multiDrawIndirect = false;
+    GLuint indirectBuffer = 0;
     Shader myShader;
 
+    GLuint gpuVAO = 0;
+    GLuint curveVAO = 0;
+    GLuint curveVBO = 0;
+    int curveCount = 0;
+    Shader gpuShaderProgram;
+    bool gpuShader = false;
+    Shader sdfShaderProgram;
+    bool sdfShader = false;
+    bool sdf = false;
+    GpuCull culler;
+    Shader cullShaderProgram;
+    GLint cullOffsetLoc = -1;
+    bool cullShader = false;
+    bool culling = false;
+    float cullPixels = 0;
+
+    Trail trail;
+    Shader trailShaderProgram;
+    GLint trailNowLoc = -1, trailFadeLoc = -1;
+    bool trailShader = false;
+    Phosphor phosphor;
+    float phosphorScale = 1;
+    bool phosphorOn = false;
+
+    float viewX = 0;
+    float viewY = 0;
+    float viewZoom = 1;
+
     int vertexCount = 0;
     int windowWidth = 1;
     int windowHeight = 1;
 
-    std::vector<Circle> circles;
-
     static constexpr int SEGMENT_NUMBER = 120;
 };
 
@@ -292,8 +819,18 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
 
-bool init_window(GLFWwindow* &window)
+// between a successful glfwInit() and close_window()
+bool glfwRunning = false;
+
+// samples 0 when nothing needs MSAA (--sdf anti-aliases in the shader)
+bool init_window(GLFWwindow* &window, int glMajor = 3, int glMinor = 3, int samples = 4)
 {
+#ifdef RENDER_NO_GLFW
+    (void)glMajor; (void)glMinor; (void)samples;
+    window = NULL;
+    cout << "ERROR::WINDOW::NOT_BUILT built with -DRENDER_NO_GLFW, run with --headless" << endl;
+    return false;
+#else
     bool success = true;
     if (!glfwInit())
     {
@@ -302,9 +839,10 @@ bool init_window(GLFWwindow* &window)
     }
     else 
     {
-        glfwWindowHint(GLFW_SAMPLES, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwRunning = true;
+        glfwWindowHint(GLFW_SAMPLES, samples);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glMajor);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glMinor);
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
         window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, NULL, NULL);
@@ -331,19 +869,107 @@ bool init_window(GLFWwindow* &window)
 
 
     return success;
+#endif
 }
 
 void close_window(GLFWwindow* &window) 
 {
-    glfwDestroyWindow(window);
-    window = NULL;
+#ifndef RENDER_NO_GLFW
+    if (window)
+        glfwDestroyWindow(window);
     glfwTerminate();
+#endif
+    window = NULL;
+    glfwRunning = false;
+}
+
+// With --headless there is no window, the functions below go to the
+// offscreen context (render/headless.h) instead of GLFW
+HeadlessContext& headless_context()
+{
+    static HeadlessContext context;
+    return context;
+}
+
+bool init_context(GLFWwindow* &window, bool headless, int glMajor, int glMinor, int samples)
+{
+    if (!headless)
+        return init_window(window, glMajor, glMinor, samples);
+    window = NULL;
+    return headless_context().init(WINDOW_WIDTH, WINDOW_HEIGHT, glMajor, glMinor, samples);
+}
+
+void close_context(GLFWwindow* &window)
+{
+    if (headless_context().active())
+        headless_context().release();
+    else if (glfwRunning)
+        close_window(window);
+}
+
+GLADloadproc context_proc_address()
+{
+#ifndef RENDER_NO_GLFW
+    if (!headless_context().active())
+        return (GLADloadproc)glfwGetProcAddress;
+#endif
+    return HeadlessContext::procAddress();
+}
+
+// seconds, like glfwGetTime
+double context_time()
+{
+#ifndef RENDER_NO_GLFW
+    if (!headless_context().active())
+        return glfwGetTime();
+#endif
+    return headless_context().time();
+}
+
+void context_framebuffer_size(GLFWwindow* window, int& w, int& h)
+{
+#ifndef RENDER_NO_GLFW
+    if (!headless_context().active())
+    {
+        glfwGetFramebufferSize(window, &w, &h);
+        return;
+    }
+#else
+    (void)window;
+#endif
+    headless_context().framebufferSize(w, h);
+}
+
+// false once the window was asked to close
+bool window_open(GLFWwindow* window)
+{
+#ifndef RENDER_NO_GLFW
+    return !glfwWindowShouldClose(window);
+#else
+    (void)window;
+    return false;
+#endif
+}
+
+// shows the frame and handles events
+void window_swap(GLFWwindow* window)
+{
+#ifndef RENDER_NO_GLFW
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+#else
+    (void)window;
+#endif
 }
 
 void processInput(GLFWwindow *window)
 {
+#ifndef RENDER_NO_GLFW
     if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+#else
+    (void)window;
+#endif
 }
 
 std::vector<float> drawCircle( GLfloat x, GLfloat y, GLfloat z, GLfloat radius, GLint numberOfSides )
@@ -364,15 +990,422 @@ std::vector<float> drawCircle( GLfloat x, GLfloat y, GLfloat z, GLfloat radius,
     return circle;
 }
 
-int main()
+// ms per frame to write n instances, upload them and have the GPU read them
+// (as points, rasterizer off), with every strategy, for whole Circle structs
+// (28 bytes, the old layout) and packed CircleInstance records (12 bytes).
+// glFinish only at the end so the strategies that keep frames in flight get
+// to do so.
+void bench_upload(CircleRenderer& renderer, const Circle& sample)
 {
-    GLFWwindow* window;
+    printf("\n[upload] ms per frame, GPU included: Circle (%zu B) / CircleInstance (%zu B)\n",
+           sizeof(Circle), sizeof(CircleInstance));
 
-    if (!init_window(window)) {
-        close_window(window);
+    const UploadStrategy strategies[] = {UPLOAD_ORPHAN, UPLOAD_SUBDATA, UPLOAD_MAP_RING, UPLOAD_PERSISTENT};
+    int counts[] = {1000, 10000, 100000, 1000000};
+    UploadStrategy previous = renderer.uploadStrategy();
+
+    for (int n : counts)
+    {
+        // cos and sin come with the chain evaluation, packing doesn't add trig
+        std::vector<Circle> source(n, sample);
+        std::vector<float> cosine(n), sine(n);
+        for (int i = 0; i < n; i++)
+        {
+            source[i].position = glm::vec3(float(i) / n, 0.0f, 0.0f);
+            cosine[i] = std::cos(source[i].starting_angle + i);
+            sine[i] = std::sin(source[i].starting_angle + i);
+        }
+
+        printf("%-8d instances", n);
+        for (UploadStrategy s : strategies)
+        {
+            if (s == UPLOAD_PERSISTENT && !gl_ext_buffer_storage())
+            {
+                printf("  %s n/a", upload_strategy_name(s));
+                continue;
+            }
+            renderer.setUploadStrategy(s);
+            printf("  %s", upload_strategy_name(s));
+
+            for (int packed = 0; packed < 2; packed++)
+            {
+                int frames = std::max(10, 10000000 / n);
+                double t0 = 0;
+                for (int f = -3; f < frames; f++)
+                {
+                    if (f == 0)
+                    {
+                        glFinish();
+                        t0 = context_time();
+                    }
+                    if (packed)
+                    {
+                        CircleInstance *dst = renderer.mapInstances(n);
+                        for (int i = 0; i < n; i++)
+                            dst[i] = pack_circle_instance(source[i].position.x, source[i].position.y,
+                                                          source[i].radius, cosine[i], sine[i]);
+                    }
+                    else
+                    {
+                        Circle *dst = renderer.mapCircleInstances(n);
+                        for (int i = 0; i < n; i++)
+                            dst[i] = source[i];
+                    }
+                    renderer.commitInstances();
+                    renderer.drawInstancePoints();
+                }
+                glFinish();
+                printf(" %s%7.3f", packed ? "/" : "", (context_time() - t0) * 1000.0 / frames);
+            }
+        }
+        printf("\n");
+    }
+
+    renderer.setUploadStrategy(previous);
+}
+
+// ms per frame to draw n circles as line strip meshes, as distance field
+// rings and with adaptive meshes, instances uploaded once. Tiny circles are about a pixel across, a
+// chain has radii falling off as 1/k like a spectrum, large ones are a
+// quarter of the window wide. Each case runs for about half a second.
+void bench_draw(CircleRenderer& renderer, float pixelsPerWorld)
+{
+    // radius 0 is the 1/k chain
+    struct Scene { const char *name; float radius; int counts[3]; };
+    const Scene scenes[] = {
+        {"tiny",  0.0025f, {1000, 10000, 100000}},
+        {"chain", 0.0f,    {1000, 10000, 100000}},
+        {"large", 0.25f,   {100, 1000, 0}},
+    };
+    bool previousSdf = renderer.usingSdf();
+    bool previousAdaptive = renderer.usingAdaptiveMesh();
+    CircleMeshLod& meshLod = renderer.adaptiveMesh();
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> pos(-0.9f, 0.9f);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * float(M_PI));
+
+    printf("\n[draw] ms per frame, GPU included: line strip mesh / sdf quad / adaptive mesh (vertices vs mesh)\n");
+    for (const Scene& scene : scenes)
+    {
+        for (int n : scene.counts)
+        {
+            if (n <= 0)
+                continue;
+            struct Sized { float radius; };
+            std::vector<Sized> sized(n);
+            for (int i = 0; i < n; i++)
+                sized[i].radius = scene.radius > 0 ? scene.radius : 0.3f / (i + 1);
+            meshLod.build(sized);
+            meshLod.assign(n, pixelsPerWorld);
+
+            // in adaptive mesh order, the other two don't care
+            CircleInstance *dst = renderer.mapInstances(n);
+            for (int i = 0; i < n; i++)
+            {
+                float a = angle(rng);
+                dst[meshLod.slot(i)] = pack_circle_instance(pos(rng) * 0.5f, pos(rng) * 0.5f, sized[i].radius,
+                                                            std::cos(a), std::sin(a));
+            }
+            renderer.commitInstances();
+
+            printf("%-6s %-8d", scene.name, n);
+            for (int mode = 0; mode < 3; mode++)
+            {
+                renderer.useSdf(mode == 1);
+                renderer.useAdaptiveMesh(mode == 2);
+                renderer.draw();
+                glFinish();
+                int frames = 0;
+                double t0 = context_time(), t = 0;
+                while (frames < 3 || t < 0.5)
+                {
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    renderer.draw();
+                    glFinish();
+                    frames++;
+                    t = context_time() - t0;
+                }
+                printf(" %s%8.3f", mode ? "/" : "", t * 1000.0 / frames);
+            }
+            printf("  (%.2fx)\n", double(meshLod.vertexTotal()) / (122.0 * n));
+        }
+    }
+
+    renderer.useSdf(previousSdf);
+    renderer.useAdaptiveMesh(previousAdaptive);
+}
+
+// ms per frame to draw a chain of 10^5 circles (radii 1/k, random angles)
+// with the view on its tip, every circle vs GPU culled (circles under half a
+// pixel dropped as well), and how many the culling kept. Instances uploaded
+// once; each case runs for about half a second.
+void bench_cull(CircleRenderer& renderer)
+{
+    const int n = 100000;
+    const float zooms[] = {1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f};
+    bool previous = renderer.usingCull();
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * float(M_PI));
+
+    CircleInstance *dst = renderer.mapInstances(n);
+    float x = 0, y = 0;
+    for (int i = 0; i < n; i++)
+    {
+        float r = 0.5f / (i + 1);
+        float a = angle(rng);
+        dst[i] = pack_circle_instance(x, y, r, std::cos(a), std::sin(a));
+        x += r * std::cos(a);
+        y += r * std::sin(a);
+    }
+    renderer.commitInstances();
+
+    printf("\n[cull] %d circle chain, ms per frame, GPU included: every circle / culled (kept)\n", n);
+    for (float zoom : zooms)
+    {
+        renderer.setView(x, y, zoom);
+        printf("zoom %-8g", zoom);
+        for (int mode = 0; mode < 2; mode++)
+        {
+            renderer.useCull(mode == 1, 0.5f);
+            renderer.draw();
+            glFinish();
+            int frames = 0;
+            double t0 = context_time(), t = 0;
+            while (frames < 3 || t < 0.5)
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+                renderer.draw();
+                glFinish();
+                frames++;
+                t = context_time() - t0;
+            }
+            printf(" %s%8.3f", mode ? "/" : "", t * 1000.0 / frames);
+        }
+        printf(" (%u)\n", renderer.culledCount());
+    }
+
+    renderer.useCull(previous, 0.5f);
+    renderer.setView(0.0f, 0.0f, 1.0f);
+}
+
+// ms per frame, GPU included, for the tip's trail as n points against the
+// phosphor image at 1, 1/2 and 1/4 resolution, with their GPU memory. Both
+// take TRAIL_PER_FRAME new points a frame; the point trail draws all n, the
+// image only the new ones whatever the trail's length. Each case runs for
+// about half a second.
+void bench_trail(CircleRenderer& renderer)
+{
+    const size_t lengths[] = {4096, 65536, 262144, 1048576};
+    const float scales[] = {1.0f, 0.5f, 0.25f};
+    const uint64_t step = 16;                   // ticks between points
+    Trail& trail = renderer.tipTrail();
+    std::vector<TrailVertex> points(TRAIL_PER_FRAME);
+    uint64_t tick = 0;
+
+    // a Lissajous figure, so the lines cross the whole view
+    auto next = [&](size_t count) {
+        for (size_t j = 0; j < count; j++)
+        {
+            tick += step;
+            double t = double(tick) / PHASE_TICK_RATE;
+            points[j] = {float(0.9 * std::sin(3.1 * t)), float(0.7 * std::sin(4.3 * t)), (uint32_t)tick};
+        }
+        trail.append(points.data(), count);
+    };
+    auto time = [&](bool phosphor, float fade) {
+        int frames = 0;
+        double t0 = context_time(), t = 0;
+        while (frames < 3 || t < 0.5)
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+            next(TRAIL_PER_FRAME);
+            if (phosphor)
+                renderer.drawPhosphor(tick, fade, TRAIL_PER_FRAME + 1, 0.99f);
+            else
+                renderer.drawTrail(tick, fade);
+            glFinish();
+            frames++;
+            t = context_time() - t0;
+        }
+        return t * 1000.0 / frames;
+    };
+
+    printf("\n[trail] ms per frame, GPU included, %zu new points a frame\n", TRAIL_PER_FRAME);
+    for (size_t n : lengths)
+    {
+        // everything drawn: the window holds n points, none faded out
+        trail.init(n + Trail::REGIONS * TRAIL_PER_FRAME, TRAIL_PER_FRAME);
+        for (size_t filled = 0; filled < n; filled += TRAIL_PER_FRAME)
+            next(TRAIL_PER_FRAME);
+        float fade = float(4 * n * step);
+        printf("points   %-8zu %8.3f  (%zu KB)\n", n, time(false, fade),
+               (n + Trail::REGIONS * TRAIL_PER_FRAME + 1) * sizeof(TrailVertex) / 1024);
+    }
+
+    trail.init((Trail::REGIONS + 1) * TRAIL_PER_FRAME + 1, TRAIL_PER_FRAME);
+    for (float scale : scales)
+    {
+        renderer.setPhosphorScale(scale);
+        const Phosphor& image = renderer.phosphorBuffer();
+        printf("phosphor %-8g %8.3f  (%dx%d, %zu KB)\n", scale, time(true, float(4 * TRAIL_PER_FRAME * step)),
+               image.bufferWidth(), image.bufferHeight(), image.bytes() / 1024);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    GLFWwindow* window = NULL;
+
+    // --stream <wav file or - for stdin> drives the circles from live audio
+    const char *streamPath = NULL;
+    StftConfig stftConfig;
+    // --scroll <n> slides the test path n samples per frame through a sliding DFT
+    int scrollPerFrame = 0;
+    // --top-k <K> / --error-budget <relative L2> keep only the bins that matter
+    int topK = 0;
+    double errorBudget = -1;
+    int samples = 512;
+    // --low-bins <K> only computes and draws the circles for frequencies -K..K
+    int lowBins = 0;
+    // --gpu evaluates the chain in a compute shader (GL 4.3, e.g. Mesa llvmpipe)
+    bool gpuMode = false;
+    // --curve <M> draws the whole traced path, M points from one inverse FFT
+    int curvePoints = 0;
+    // --export <file> <seconds> writes the tip at every 60 fps frame as "t x y" lines
+    const char *exportPath = NULL;
+    double exportSeconds = 0;
+    // --lod <pixels> stops the chain once the rest of it can't move the tip that far
+    float lodPixels = 0;
+    // --upload <orphan|subdata|map-ring|persistent> picks how instances reach the GPU
+    const char *uploadName = NULL;
+    // --bench-upload times every upload strategy for 10^3 to 10^6 instances and exits
+    bool benchUpload = false;
+    // --sdf draws each circle as one quad shaded by a distance field, no MSAA
+    bool sdfMode = false;
+    // --bench-draw times the mesh and sdf circles for several sizes and exits
+    bool benchDraw = false;
+    // --tessellate picks each circle's mesh from its size on screen
+    bool tessellate = false;
+    // --zoom <factor> magnifies the view around the tip of the chain
+    float zoom = 1.0f;
+    // --cull <pixels> culls circles off screen or under that radius on the GPU (GL 4.3)
+    float cullPixels = -1.0f;
+    // --bench-cull times drawing a 10^5 circle chain with and without culling and exits
+    bool benchCull = false;
+    // --trail <seconds> draws the path of the tip, fading out over that long
+    double trailSeconds = 0;
+    // --phosphor <scale> keeps the --trail as a fading image at that fraction
+    // of the window's resolution instead of as points
+    float phosphorScale = 0;
+    // --bench-trail times the point trail against the phosphor image and exits
+    bool benchTrail = false;
+    // --headless <frames> renders that many frames without a window (EGL, build
+    // with -DRENDER_HEADLESS -lEGL, and -DRENDER_NO_GLFW to drop -lglfw),
+    // prints the frame times and exits;
+    // --frame-step <seconds> makes its clock step a fixed amount per frame and
+    // --save-frames <prefix> writes every frame to <prefix>00000.ppm on
+    int headlessFrames = 0;
+    double frameStep = 0;
+    const char *savePrefix = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        // FFTW is the default, the builtin engine is what -DFFT_NO_FFTW builds use
+        if (strcmp(argv[i], "--builtin-fft") == 0)
+            fft_backend() = FFT_BACKEND_BUILTIN;
+        else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc)
+            streamPath = argv[++i];
+        else if (strcmp(argv[i], "--fft-size") == 0 && i + 1 < argc)
+            stftConfig.fftSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hop") == 0 && i + 1 < argc)
+            stftConfig.hop = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+            stftConfig.window = parse_window(argv[++i]);
+        else if (strcmp(argv[i], "--scroll") == 0 && i + 1 < argc)
+            scrollPerFrame = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--top-k") == 0 && i + 1 < argc)
+            topK = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--error-budget") == 0 && i + 1 < argc)
+            errorBudget = atof(argv[++i]);
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--low-bins") == 0 && i + 1 < argc)
+            lowBins = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--gpu") == 0)
+            gpuMode = true;
+        else if (strcmp(argv[i], "--curve") == 0 && i + 1 < argc)
+            curvePoints = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--export") == 0 && i + 2 < argc)
+        {
+            exportPath = argv[++i];
+            exportSeconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lod") == 0 && i + 1 < argc)
+            lodPixels = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--upload") == 0 && i + 1 < argc)
+            uploadName = argv[++i];
+        else if (strcmp(argv[i], "--bench-upload") == 0)
+            benchUpload = true;
+        else if (strcmp(argv[i], "--sdf") == 0)
+            sdfMode = true;
+        else if (strcmp(argv[i], "--bench-draw") == 0)
+            benchDraw = true;
+        else if (strcmp(argv[i], "--tessellate") == 0)
+            tessellate = true;
+        else if (strcmp(argv[i], "--zoom") == 0 && i + 1 < argc)
+            zoom = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--cull") == 0 && i + 1 < argc)
+            cullPixels = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--bench-cull") == 0)
+            benchCull = true;
+        else if (strcmp(argv[i], "--trail") == 0 && i + 1 < argc)
+            trailSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--phosphor") == 0 && i + 1 < argc)
+            phosphorScale = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--bench-trail") == 0)
+            benchTrail = true;
+        else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+            headlessFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frame-step") == 0 && i + 1 < argc)
+            frameStep = atof(argv[++i]);
+        else if (strcmp(argv[i], "--save-frames") == 0 && i + 1 < argc)
+            savePrefix = argv[++i];
+    }
+
+    // a frame needs two samples and a hop at least one new one
+    if (stftConfig.fftSize < 2 || stftConfig.hop < 1)
+    {
+        cout << "ERROR::STFT::BAD_CONFIG --fft-size " << stftConfig.fftSize
+             << " --hop " << stftConfig.hop << endl;
         return -1;
     }
-    
+
+    // macOS stops at 4.1, the GPU paths then fall back to the CPU ones
+    int msaaSamples = sdfMode ? 0 : 4;
+    bool culling = cullPixels >= 0 || benchCull;
+    bool wantCompute = gpuMode || culling;
+    bool headless = headlessFrames > 0;
+    if (wantCompute && !init_context(window, headless, 4, 3, msaaSamples)) {
+        cout << "GL 4.3 not available, evaluating the chain on the CPU and drawing every circle" << endl;
+        close_context(window);
+        wantCompute = gpuMode = culling = false;
+    }
+    if (!wantCompute && !init_context(window, headless, 3, 3, msaaSamples)) {
+        close_context(window);
+        return -1;
+    }
+    if (headless)
+        headless_context().setFixedStep(frameStep);
+    bool computeShaders = gl_ext_load(context_proc_address());
+    if (wantCompute && !computeShaders) {
+        cout << "compute shaders not available, evaluating the chain on the CPU and drawing every circle" << endl;
+        gpuMode = culling = false;
+    }
+
+    UploadStrategy upload = upload_strategy_default();
+    if (uploadName && !parse_upload_strategy(uploadName, upload))
+        cout << "ERROR::UPLOAD::UNKNOWN_STRATEGY " << uploadName << endl;
+    printf("instance upload: %s\n", upload_strategy_name(upload));
    
     CircleRenderer renderer;
     
@@ -380,18 +1413,67 @@ int main()
         WINDOW_WIDTH,
         WINDOW_HEIGHT,
         vertexCodeString,
-        fragmentCodeString
+        fragmentCodeString,
+        upload
     );
-    glfwSetWindowUserPointer(window, &renderer);
+    if (gpuMode)
+        renderer.initGpu(gpuVertexCodeString, fragmentCodeString);
+    if (sdfMode || benchDraw)
+        renderer.initSdf(sdfVertexCodeString, sdfFragmentCodeString);
+    renderer.useSdf(sdfMode);
+    renderer.useAdaptiveMesh(tessellate);
+    if (culling)
+        renderer.initCull(cullVertexCodeString, fragmentCodeString, cullComputeCodeString);
+    renderer.useCull(culling, std::max(cullPixels, 0.0f));
+    // the phosphor image only needs this frame's points from the trail
+    bool phosphor = phosphorScale > 0 && trailSeconds > 0;
+    if (trailSeconds > 0 || benchTrail)
+        renderer.initTrail(trailVertexCodeString, trailFragmentCodeString,
+                           phosphor ? (Trail::REGIONS + 1) * TRAIL_PER_FRAME + 1 : TRAIL_CAPACITY,
+                           TRAIL_PER_FRAME);
+    if (phosphor || benchTrail)
+        renderer.initPhosphor(phosphorVertexCodeString, phosphorFragmentCodeString,
+                              phosphor ? phosphorScale : 1.0f);
+#ifndef RENDER_NO_GLFW
+    if (window)
+        glfwSetWindowUserPointer(window, &renderer);
+#endif
 
     int w, h;
-    glfwGetFramebufferSize(window, &w, &h);
+    context_framebuffer_size(window, w, h);
     renderer.onResize(w, h);
+    renderer.setView(0.0f, 0.0f, zoom);
+
+    // MEASURE plans are only slow the first time, wisdom makes later runs free
+    fft_load_wisdom<Scalar>(wisdomFileString);
+    fft_thread_config().threads = ThreadPool::defaultThreads();
 
 
     std::vector<Circle> circles;
 
-    const int NUM_CIRCLES = 512;
+    int NUM_CIRCLES = samples;
+    // test_func is real valued, so r2c halves the FFT and coefficient storage
+    bool REAL_INPUT = false;
+
+    SpscRingBuffer<float> *audioRing = NULL;
+    PcmReader *pcmReader = NULL;
+    StftWorker<Scalar> *stft = NULL;
+    if (streamPath)
+    {
+        // one circle per STFT bin, the first frame is test_func until audio arrives
+        NUM_CIRCLES = stftConfig.fftSize;
+        REAL_INPUT = true;
+
+        // the worker pops a whole hop at once, so it must fit with room to spare
+        audioRing = new SpscRingBuffer<float>(std::max(stftConfig.fftSize, stftConfig.hop) * 16);
+        pcmReader = new PcmReader(*audioRing);
+        stft = new StftWorker<Scalar>(*audioRing, stftConfig);
+        if (pcmReader->open(streamPath))
+        {
+            pcmReader->start();
+            stft->start();
+        }
+    }
 
     // random generators
     std::mt19937 rng(std::random_device{}());
@@ -399,68 +1481,354 @@ int main()
     std::uniform_real_distribution<float> posY(-0.9f, 0.9f);
     std::uniform_real_distribution<float> radiusDist(0.02f, 0.06f);
 
-    fftw_complex *output = fft_test(NUM_CIRCLES, FFTW_FORWARD);
+    bool selecting = (topK > 0 || errorBudget >= 0) && !stft && scrollPerFrame <= 0;
+    bool pruned = lowBins > 0 && !selecting && !stft && scrollPerFrame <= 0 && 2 * lowBins + 1 < NUM_CIRCLES;
+
+    FFTW<Scalar>::complex *output;
+    if (REAL_INPUT)
+        output = fft_test_real<Scalar>(NUM_CIRCLES);
+    else if (pruned)
+        output = fft_test_pruned<Scalar>(NUM_CIRCLES, lowBins, FFTW_FORWARD);
+    else
+        output = fft_test<Scalar>(NUM_CIRCLES, FFTW_FORWARD);
 
     circles.clear();
-    circles.reserve(NUM_CIRCLES);
 
-    for (int i = 0; i < NUM_CIRCLES; ++i)
+    if (selecting)
     {
-        circles.emplace_back(
-            i,
-            output,
-            NUM_CIRCLES
-        );
+        // most bins carry next to no energy, only the chosen ones become circles
+        CoefficientSelection selection = (topK > 0)
+            ? select_top_k(output, NUM_CIRCLES, topK, REAL_INPUT)
+            : select_error_budget(output, NUM_CIRCLES, errorBudget, REAL_INPUT);
+        printf("kept %zu of %d coefficients, relative L2 error %f\n",
+               selection.bins.size(), NUM_CIRCLES, selection.error);
+
+        circles.reserve(selection.bins.size());
+        for (int k : selection.bins)
+            circles.emplace_back(orderIndex(k, NUM_CIRCLES), output, NUM_CIRCLES, REAL_INPUT);
+    }
+    else
+    {
+        // mapIndex goes DC outward, so bins -K..K are exactly the first 2K+1 circles
+        int count = pruned ? 2 * lowBins + 1 : NUM_CIRCLES;
+        circles.reserve(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            circles.emplace_back(
+                i,
+                output,
+                NUM_CIRCLES,
+                REAL_INPUT
+            );
+        }
     }
 
     renderer.setCircles(circles);
 
-    glfwSetFramebufferSizeCallback(
-        window,
-        [](GLFWwindow* win, int w, int h)
+    if (benchUpload && !circles.empty())
+    {
+        bench_upload(renderer, circles[0]);
+        close_context(window);
+        return 0;
+    }
+    if (benchCull && renderer.usingCull())
+    {
+        bench_cull(renderer);
+        close_context(window);
+        return 0;
+    }
+    if (benchTrail)
+    {
+        bench_trail(renderer);
+        close_context(window);
+        return 0;
+    }
+    if (benchDraw)
+    {
+        bench_draw(renderer, 1.0f / lod_world_per_pixel(w));
+        close_context(window);
+        return 0;
+    }
+
+    SlidingDFT<Scalar> *sliding = NULL;
+    long long scrollSample = NUM_CIRCLES;
+    if (scrollPerFrame > 0 && !stft && !REAL_INPUT)
+    {
+        std::vector<FFTW<Scalar>::complex> path(NUM_CIRCLES);
+        for (int x = 0; x < NUM_CIRCLES; x++)
         {
-            glViewport(0, 0, w, h);
+            path[x][0] = 1;
+            path[x][1] = test_func(float(x) / NUM_CIRCLES);
+        }
+        sliding = new SlidingDFT<Scalar>(NUM_CIRCLES);
+        sliding->reset(path.data());
+    }
 
-            auto* renderer =
-                static_cast<CircleRenderer*>(
-                    glfwGetWindowUserPointer(win)
-                );
+    // start phases are taken before the loop overwrites starting_angle with
+    // the current angle, reloaded whenever a new spectrum updates the circles
+    PhaseEngine phases;
+    phases.load(circles);
+    ChainLod lod;
+    lod.build(circles);
+    renderer.adaptiveMesh().build(circles);
+    TipBatch trailTips;
+    if (trailSeconds > 0)
+        trailTips.load(circles);
+
+    CurveReconstruction<Scalar> curve;
+    std::vector<float> curveVerts;
+    auto rebuildCurve = [&]() {
+        if (curvePoints <= 0)
+            return;
+        curve.build(circles, curvePoints);
+        curve.vertices(curveVerts);
+        renderer.setCurve(curveVerts);
+    };
+    rebuildCurve();
+
+    // every frame's tip in one batch instead of a chain pass per frame
+    if (exportPath && exportSeconds > 0)
+    {
+        size_t frames = (size_t)(exportSeconds * 60.0);
+        // a whole number of ticks per frame keeps the times evenly spaced
+        uint64_t frameTicks = phase_ticks(1.0 / 60.0);
+        std::vector<uint64_t> ticks(frames);
+        for (size_t f = 0; f < frames; f++)
+            ticks[f] = f * frameTicks;
+        std::vector<float> tipX(frames), tipY(frames);
+
+        TipBatch tips;
+        tips.load(circles);
+        TipMethod method = tips.evaluate(ticks.data(), frames, tipX.data(), tipY.data(), ThreadPool::instance());
+
+        std::ofstream out(exportPath);
+        if (!out)
+            cout << "ERROR::EXPORT::FILE_NOT_SUCCESFULLY_OPENED " << exportPath << endl;
+        for (size_t f = 0; out && f < frames; f++)
+            out << ticks[f] / PHASE_TICK_RATE << " " << tipX[f] << " " << tipY[f] << "\n";
+        printf("exported %zu frames (%s)\n", frames, tip_method_name(method));
+    }
+    printf("epicycle kernel: %s\n", epicycle_kernel_name(epicycle_kernel()));
+
+    // coefficients stay on the GPU, a frame only sets the base phase
+    GpuChain *gpu = NULL;
+    if (gpuMode)
+    {
+        gpu = new GpuChain();
+        gpu->init(computeCodeString);
+        gpu->load(circles);
+    }
+
+#ifndef RENDER_NO_GLFW
+    if (window)
+    {
+        glfwSetFramebufferSizeCallback(
+            window,
+            [](GLFWwindow* win, int w, int h)
+            {
+                glViewport(0, 0, w, h);
+
+                auto* renderer =
+                    static_cast<CircleRenderer*>(
+                        glfwGetWindowUserPointer(win)
+                    );
+
+                if (renderer)
+                    renderer->onResize(w, h);
+            }
+        );
+    }
+#endif
 
-            if (renderer)
-                renderer->onResize(w, h);
-        }
-    );
 
 
+    // scratch for the trail's points of one frame, allocated once
+    std::vector<uint64_t> trailTicks(TRAIL_PER_FRAME);
+    std::vector<float> trailX(TRAIL_PER_FRAME), trailY(TRAIL_PER_FRAME);
+    std::vector<TrailVertex> trailPoints(TRAIL_PER_FRAME);
+    uint64_t trailTick = 0;
+    bool trailStarted = false;
+    size_t trailNew = 0;
+    float trailDecay = 1.0f;
 
-    while(!glfwWindowShouldClose(window))
+    HeadlessContext& offscreen = headless_context();
+    std::vector<char> framePath(savePrefix ? strlen(savePrefix) + 16 : 0);
+    while(headless ? offscreen.frameCount() < headlessFrames : window_open(window))
     {
         //input
-        processInput(window);
+        if (window)
+            processInput(window);
+
+        if (stft)
+        {
+            // never waits on the worker, keeps the old circles if no hop finished
+            FFTW<Scalar>::complex *spectrum = stft->latest();
+            if (spectrum)
+            {
+                for (int i = 0; i < NUM_CIRCLES; i++)
+                    circles[i].update(i, spectrum, NUM_CIRCLES, true);
+                phases.load(circles);
+                lod.build(circles);
+                renderer.adaptiveMesh().build(circles);
+                if (trailSeconds > 0)
+                    trailTips.load(circles);
+                rebuildCurve();
+                if (gpu)
+                    gpu->load(circles);
+            }
+        }
+
+        if (sliding)
+        {
+            // O(N) per new sample instead of a full FFT, circles updated in place
+            for (int n = 0; n < scrollPerFrame; n++, scrollSample++)
+            {
+                float x = float(scrollSample % NUM_CIRCLES) / NUM_CIRCLES;
+                sliding->push(1, test_func(x));
+            }
+            for (int i = 0; i < NUM_CIRCLES; i++)
+                circles[i].update(i, sliding->spectrum(), NUM_CIRCLES);
+            phases.load(circles);
+            lod.build(circles);
+            renderer.adaptiveMesh().build(circles);
+            if (trailSeconds > 0)
+                trailTips.load(circles);
+            rebuildCurve();
+            if (gpu)
+                gpu->load(circles);
+        }
 
-        float time = glfwGetTime();
-        glm::vec2 pos(0.0f);
+        // fixed-point phases, a float time would drift after hours of uptime
+        uint64_t tick = phase_ticks(context_time());
+        int fbWidth, fbHeight;
+        context_framebuffer_size(window, fbWidth, fbHeight);
+        float worldPerPixel = lod_world_per_pixel(fbWidth, zoom);
+
+        // the tip since the last frame, in as many points as keep them about
+        // TRAIL_SPACING_PIXELS apart however fast it moves (up to TRAIL_PER_FRAME)
+        trailNew = 0;
+        trailDecay = 1.0f;
+        if (trailSeconds > 0 && (!trailStarted || tick > trailTick))
+        {
+            uint64_t fade = phase_ticks(trailSeconds);
+            // the phosphor image falls to 1/256 over the trail's length
+            if (trailStarted)
+                trailDecay = (float)std::pow(1.0 / 256.0, double(tick - trailTick) / double(fade));
+            uint64_t from = trailStarted ? std::max(trailTick, tick > fade ? tick - fade : 0) : tick;
+            uint64_t span = tick - from;
+            double spacing = TRAIL_SPACING_PIXELS * worldPerPixel;
+            size_t k = (size_t)std::ceil(trailTips.tickSpeed() * double(span) / spacing);
+            k = std::max<size_t>(1, std::min<size_t>(k, std::min<uint64_t>(TRAIL_PER_FRAME, std::max<uint64_t>(span, 1))));
+
+            for (size_t j = 0; j < k; j++)
+                trailTicks[j] = from + span * (j + 1) / k;
+            trailTips.evaluate(trailTicks.data(), k, trailX.data(), trailY.data(), ThreadPool::instance());
+            for (size_t j = 0; j < k; j++)
+                trailPoints[j] = {trailX[j], trailY[j], (uint32_t)trailTicks[j]};
+            renderer.tipTrail().append(trailPoints.data(), k);
+
+            trailNew = k;
+            trailTick = tick;
+            trailStarted = true;
+        }
 
-        for (auto& c : circles){
-            float a = c.starting_angle + c.frequency * time;
-            c.position = glm::vec3(pos, 0.0f);
-            pos += c.radius * glm::vec2(cos(a), sin(a));
+        if (gpu)
+        {
+            gpu->dispatch(tick);
         }
+        else
+        {
+            // sub-pixel tail: neither evaluated nor drawn, the limit follows the window size and zoom
+            ChainLod::Cut cut = {0, 0.0f, 0.0f, 0.0f};
+            if (lodPixels > 0)
+            {
+                cut = lod.cut(lodPixels * worldPerPixel);
+                phases.limit(cut.count);
+            }
+
+            // a tail that can still move the tip a pixel or more is shown as
+            // the disc the tip stays inside
+            size_t drawn = phases.activeSize();
+            bool envelope = lodPixels > 0 && cut.envelope >= worldPerPixel && drawn > 0;
+            CircleInstance *instances = renderer.mapInstances(drawn + (envelope ? 1 : 0));
+
+            // adaptive meshes: instances grouped by mesh level, circle i goes to slots[i]
+            const uint32_t *slots = NULL;
+            if (renderer.usingAdaptiveMesh())
+            {
+                CircleMeshLod& meshLod = renderer.adaptiveMesh();
+                meshLod.assign(drawn, 1.0f / worldPerPixel, envelope ? cut.envelope : -1.0f);
+                slots = meshLod.slotData();
+            }
 
-        renderer.setCircles(circles);
+            // the running sum is split across the pool, each thread writes the
+            // instance data of its own chunk straight into the upload buffer
+            const float *chainX = phases.x();
+            const float *chainY = phases.y();
+            const float *chainAngle = phases.angle();
+            const float *chainCos = phases.cosine();
+            const float *chainSin = phases.sine();
+            phases.evaluate(tick, ThreadPool::instance(), [&](size_t first, size_t count){
+                for (size_t i = first; i < first + count; i++){
+                    circles[i].position = glm::vec3(chainX[i], chainY[i], 0.0f);
+                    circles[i].starting_angle = chainAngle[i];
+                    instances[slots ? slots[i] : i] = pack_circle_instance(chainX[i], chainY[i], circles[i].radius,
+                                                                           chainCos[i], chainSin[i]);
+                }
+            });
+
+            float tipX = phases.tipX() + cut.offsetX;
+            float tipY = phases.tipY() + cut.offsetY;
+            if (envelope)
+                instances[slots ? slots[drawn] : drawn] = pack_circle_instance(tipX, tipY, cut.envelope, 1.0f, 0.0f);
+            renderer.commitInstances();
+
+            // zoomed in, the view follows the tip
+            if (zoom != 1.0f)
+                renderer.setView(tipX, tipY, zoom);
+        }
 
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        renderer.draw();
+        renderer.drawCurve();
+        if (phosphor)
+            renderer.drawPhosphor(tick, float(phase_ticks(trailSeconds)), trailNew + 1, trailDecay);
+        else if (trailSeconds > 0)
+            renderer.drawTrail(tick, float(phase_ticks(trailSeconds)));
+        if (gpu)
+            renderer.drawGpu(*gpu);
+        else
+            renderer.draw();
 
-        //check and call events and swap the buffers
-        glfwSwapBuffers(window);
-        glfwPollEvents();    
+        if (headless)
+        {
+            offscreen.present();
+            if (savePrefix)
+            {
+                snprintf(framePath.data(), framePath.size(), "%s%05d.ppm", savePrefix, offscreen.frameCount() - 1);
+                offscreen.writePPM(framePath.data());
+            }
+        }
+        else
+        {
+            //check and call events and swap the buffers
+            window_swap(window);
+        }
     }
+    if (headless)
+        offscreen.report();
 
-    close_window(window);
-    glfwTerminate();
+    delete gpu;
+    delete sliding;
+    delete stft;
+    delete pcmReader;
+    delete audioRing;
+
+    fft_save_wisdom<Scalar>(wisdomFileString);
+
+    close_context(window);
 
     return 0;
 }